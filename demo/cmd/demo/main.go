@@ -2,31 +2,109 @@ package main
 
 import (
 	"bwe/demo/pkg/attr"
+	"bwe/demo/pkg/logging"
+	"bwe/demo/pkg/server"
+	"flag"
 	"fmt"
 	"log/slog"
 	"net/http"
+	"os"
+	"os/signal"
+	"syscall"
 
 	"golang.org/x/net/websocket"
 )
 
 func main() {
-	config, err := LoadConfig()
+	configPath := flag.String("config", "", "path to config")
+	flag.Parse()
+
+	config, err := server.LoadConfig(*configPath)
 	if err != nil {
 		slog.Error("load config", attr.Error(err))
 		return
 	}
 
-	pcFactory, err := newPeerConnectionFactory(config)
+	logHandler, err := logging.New(os.Stderr, config.Log)
+	if err != nil {
+		slog.Error("new log handler", attr.Error(err))
+		return
+	}
+	defer logHandler.Close()
+	slog.SetDefault(slog.New(logHandler))
+	server.Metrics.NewGaugeFunc("bwe_log_records_dropped", "Log records dropped on a full log queue.", func() float64 {
+		return float64(logHandler.Dropped())
+	})
+	server.Metrics.NewGaugeFunc("bwe_log_records_suppressed", "Log records over the rate limit of their message.", func() float64 {
+		return float64(logHandler.Suppressed())
+	})
+
+	handler, err := server.NewHandler(config, nil)
 	if err != nil {
-		slog.Error("new peer connection factory", attr.Error(err))
+		slog.Error("new handler", attr.Error(err))
 		return
 	}
-	handler := Handler{
-		PeerConnectionFactory: pcFactory,
-		VideoPaths:            config.VideoPaths,
+
+	defer func() {
+		err = handler.Close()
+		if err != nil {
+			slog.Error("close handler", attr.Error(err))
+		}
+	}()
+
+	// SIGHUP and POST /reload read the video paths from the config again.
+	// Sessions keep streaming while the videos load in the background.
+	// Requests during a reload coalesce into one more reload.
+	reloads := make(chan struct{}, 1)
+	requestReload := func() {
+		select {
+		case reloads <- struct{}{}:
+		default:
+		}
+	}
+	go func() {
+		for range reloads {
+			reloaded, err := server.LoadConfig(*configPath)
+			if err != nil {
+				slog.Error("reload config", attr.Error(err))
+				continue
+			}
+			if err := handler.Reload(reloaded.VideoPaths); err != nil {
+				slog.Error("reload videos", attr.Error(err))
+			}
+		}
+	}()
+	hangup := make(chan os.Signal, 1)
+	signal.Notify(hangup, syscall.SIGHUP)
+	go func() {
+		for range hangup {
+			requestReload()
+		}
+	}()
+
+	if config.AdminAddr != "" {
+		admin := http.NewServeMux()
+		admin.HandleFunc("/reload", func(w http.ResponseWriter, r *http.Request) {
+			if r.Method != http.MethodPost {
+				http.Error(w, "method not allowed", http.StatusMethodNotAllowed)
+				return
+			}
+			requestReload()
+			w.WriteHeader(http.StatusAccepted)
+		})
+		admin.Handle("/sessions", handler.Sessions)
+		if config.Relay.Role == server.RoleOrigin {
+			admin.Handle("/relay", websocket.Handler(handler.Relay))
+		}
+		go func() {
+			if err := http.ListenAndServe(config.AdminAddr, admin); err != nil {
+				slog.Error("listen and serve admin", attr.Error(err))
+			}
+		}()
 	}
 
 	http.Handle("/watch", websocket.Handler(handler.Watch))
+	http.Handle("/metrics", server.Metrics)
 
 	err = http.ListenAndServe(fmt.Sprintf(":%d", config.Port), nil)
 	if err != nil {
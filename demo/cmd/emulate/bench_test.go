@@ -0,0 +1,116 @@
+package main
+
+import (
+	"bwe/demo/pkg/client"
+	"bwe/demo/pkg/ivftest"
+	"bwe/demo/pkg/report"
+	"bwe/demo/pkg/server"
+	"fmt"
+	"io"
+	"log/slog"
+	"path/filepath"
+	"runtime"
+	"runtime/metrics"
+	"testing"
+	"time"
+)
+
+// benchScenario runs sessions on an unshaped network with a 720 kbps video.
+func benchScenario(b *testing.B, sessions int, duration time.Duration) (Scenario, server.Config, client.Config) {
+	b.Helper()
+
+	previous := slog.Default()
+	slog.SetDefault(slog.New(slog.NewTextHandler(io.Discard, nil)))
+	b.Cleanup(func() { slog.SetDefault(previous) })
+
+	dir := b.TempDir()
+	video := filepath.Join(dir, "video.ivf")
+	ivftest.Write(b, video, "VP80", 900, 3000)
+
+	scenario := Scenario{
+		Clients:    sessions,
+		VideoPaths: []string{video},
+		ReportFile: filepath.Join(dir, "report.log"),
+	}
+	serverConfig := server.Config{}
+	clientConfig := client.Config{
+		SessionDuration:     duration,
+		ReportInterval:      time.Second,
+		ReportFormat:        report.FormatBinary,
+		ReportFlushInterval: time.Second,
+		ReportQueueSize:     1024,
+	}
+	scenario.override(&serverConfig, &clientConfig)
+
+	return scenario, serverConfig, clientConfig
+}
+
+func runBench(b *testing.B, scenario Scenario, serverConfig server.Config, clientConfig client.Config) []client.SessionResult {
+	b.Helper()
+
+	results, err := run(scenario, serverConfig, clientConfig)
+	if err != nil {
+		b.Fatal(err)
+	}
+	for _, result := range results {
+		if result.Err != nil {
+			b.Fatal(result.Err)
+		}
+		if !result.FirstFrame {
+			b.Fatalf("session %d received no frame", result.ID)
+		}
+	}
+	return results
+}
+
+// BenchmarkWatchSetup measures the time from dialing the websocket to the
+// first received frame, with ICE and DTLS over the virtual network.
+func BenchmarkWatchSetup(b *testing.B) {
+	scenario, serverConfig, clientConfig := benchScenario(b, 1, 2*time.Second)
+
+	var setup time.Duration
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		setup += runBench(b, scenario, serverConfig, clientConfig)[0].Setup
+	}
+	b.ReportMetric(float64(setup)/float64(time.Millisecond)/float64(b.N), "setup-ms/op")
+}
+
+// cpuSeconds returns the CPU time used by the process so far.
+func cpuSeconds() float64 {
+	samples := []metrics.Sample{
+		{Name: "/cpu/classes/total:cpu-seconds"},
+		{Name: "/cpu/classes/idle:cpu-seconds"},
+	}
+	metrics.Read(samples)
+	return samples[0].Value.Float64() - samples[1].Value.Float64()
+}
+
+// BenchmarkSessions measures steady-state cost per concurrent session. The
+// server and the clients share the process, so sessions/core counts both
+// ends of every session.
+func BenchmarkSessions(b *testing.B) {
+	for _, sessions := range []int{1, 4, 16} {
+		b.Run(fmt.Sprintf("sessions=%d", sessions), func(b *testing.B) {
+			scenario, serverConfig, clientConfig := benchScenario(b, sessions, 5*time.Second)
+
+			var frames uint64
+			var before, after runtime.MemStats
+			runtime.ReadMemStats(&before)
+			cpu := cpuSeconds()
+			b.ResetTimer()
+			for i := 0; i < b.N; i++ {
+				for _, result := range runBench(b, scenario, serverConfig, clientConfig) {
+					frames += result.FramesReceived
+				}
+			}
+			b.StopTimer()
+			cpu = cpuSeconds() - cpu
+			runtime.ReadMemStats(&after)
+
+			b.ReportMetric(float64(frames)/b.Elapsed().Seconds(), "frames/s")
+			b.ReportMetric(float64(after.Mallocs-before.Mallocs)/float64(max(frames, 1)), "allocs/frame")
+			b.ReportMetric(float64(sessions)*b.Elapsed().Seconds()/cpu, "sessions/core")
+		})
+	}
+}
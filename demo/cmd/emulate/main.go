@@ -0,0 +1,94 @@
+package main
+
+import (
+	"bwe/demo/pkg/attr"
+	"bwe/demo/pkg/client"
+	"bwe/demo/pkg/emulation"
+	"bwe/demo/pkg/server"
+	"flag"
+	"fmt"
+	"log/slog"
+	"net"
+	"net/http"
+
+	"github.com/pion/transport/v3"
+	"golang.org/x/net/websocket"
+)
+
+func main() {
+	scenarioPath := flag.String("scenario", "", "path to scenario")
+	flag.Parse()
+
+	scenario, err := LoadScenario(*scenarioPath)
+	if err != nil {
+		slog.Error("load scenario", attr.Error(err))
+		return
+	}
+
+	serverConfig, clientConfig, err := scenario.Configs()
+	if err != nil {
+		slog.Error("load configs", attr.Error(err))
+		return
+	}
+
+	_, err = run(scenario, serverConfig, clientConfig)
+	if err != nil {
+		slog.Error("run scenario", attr.Error(err))
+	}
+}
+
+// run starts the network and the server, then plays the client sessions to
+// the end.
+func run(scenario Scenario, serverConfig server.Config, clientConfig client.Config) ([]client.SessionResult, error) {
+	network, err := emulation.New(scenario.Network, scenario.Clients)
+	if err != nil {
+		return nil, fmt.Errorf("new network: %w", err)
+	}
+
+	defer func() {
+		err := network.Close()
+		if err != nil {
+			slog.Error("close network", attr.Error(err))
+		}
+	}()
+
+	handler, err := server.NewHandler(serverConfig, network.Server)
+	if err != nil {
+		return nil, fmt.Errorf("new handler: %w", err)
+	}
+
+	defer func() {
+		err := handler.Close()
+		if err != nil {
+			slog.Error("close handler", attr.Error(err))
+		}
+	}()
+
+	// Signaling stays on loopback, only media crosses the emulated network.
+	listener, err := net.Listen("tcp", "127.0.0.1:0")
+	if err != nil {
+		return nil, fmt.Errorf("listen: %w", err)
+	}
+	defer listener.Close()
+
+	mux := http.NewServeMux()
+	mux.Handle("/watch", websocket.Handler(handler.Watch))
+	mux.Handle("/sessions", handler.Sessions)
+	go func() {
+		_ = http.Serve(listener, mux)
+	}()
+
+	clientConfig.Endpoint = "ws://" + listener.Addr().String() + "/watch"
+
+	networks := make([]transport.Net, len(network.Clients))
+	for i, clientNet := range network.Clients {
+		networks[i] = clientNet
+	}
+
+	err = network.Start()
+	if err != nil {
+		return nil, fmt.Errorf("start network: %w", err)
+	}
+
+	return client.Run(clientConfig, networks)
+}
@@ -0,0 +1,72 @@
+package main
+
+import (
+	"bwe/demo/pkg/client"
+	"bwe/demo/pkg/emulation"
+	"bwe/demo/pkg/server"
+	"fmt"
+	"os"
+
+	"gopkg.in/yaml.v3"
+)
+
+// Scenario runs the server and Clients client sessions in one process over
+// the emulated network. The server and client configs are reused, with the
+// settings that do not apply on the virtual network overridden.
+type Scenario struct {
+	ServerConfig     string           `yaml:"server_config"`
+	ClientConfig     string           `yaml:"client_config"`
+	VideoPaths       []string         `yaml:"video_paths"`
+	Clients          int              `yaml:"clients"`
+	ReportFile       string           `yaml:"report_file"`
+	ServerReportFile string           `yaml:"server_report_file"`
+	Network          emulation.Config `yaml:"network"`
+}
+
+func LoadScenario(path string) (Scenario, error) {
+	scenarioBytes, err := os.ReadFile(path)
+	if err != nil {
+		return Scenario{}, fmt.Errorf("read file: %w", err)
+	}
+	var scenario Scenario
+	err = yaml.Unmarshal(scenarioBytes, &scenario)
+	if err != nil {
+		return Scenario{}, fmt.Errorf("yaml unmarshal: %w", err)
+	}
+
+	scenario.Clients = max(scenario.Clients, 1)
+	return scenario, nil
+}
+
+func (s Scenario) Configs() (server.Config, client.Config, error) {
+	serverConfig, err := server.LoadConfig(s.ServerConfig)
+	if err != nil {
+		return server.Config{}, client.Config{}, fmt.Errorf("load server config: %w", err)
+	}
+
+	clientConfig, err := client.LoadConfig(s.ClientConfig)
+	if err != nil {
+		return server.Config{}, client.Config{}, fmt.Errorf("load client config: %w", err)
+	}
+
+	s.override(&serverConfig, &clientConfig)
+	return serverConfig, clientConfig, nil
+}
+
+// override adapts the configs to the virtual network. There is no STUN
+// server and the ICE muxes would bind host sockets.
+func (s Scenario) override(serverConfig *server.Config, clientConfig *client.Config) {
+	serverConfig.IceServer = ""
+	serverConfig.Transport.UDPPort = 0
+	serverConfig.Transport.TCPPort = 0
+	serverConfig.Report.File = s.ServerReportFile
+	if len(s.VideoPaths) > 0 {
+		serverConfig.VideoPaths = s.VideoPaths
+	}
+
+	clientConfig.IceServer = ""
+	clientConfig.Sessions = s.Clients
+	if s.ReportFile != "" {
+		clientConfig.ReportFile = s.ReportFile
+	}
+}
@@ -0,0 +1,163 @@
+package main
+
+import (
+	"bwe/demo/pkg/attr"
+	"bwe/demo/pkg/report"
+	"cmp"
+	"errors"
+	"flag"
+	"fmt"
+	"io"
+	"log/slog"
+	"os"
+	"slices"
+	"time"
+)
+
+func main() {
+	input := flag.String("input", "", "client or server report")
+	output := flag.String("output", "", "aggregated report")
+	format := flag.String("format", string(report.FormatBinary), "output format, json or binary")
+	window := flag.Duration("window", 5*time.Second, "aggregation window")
+	flag.Parse()
+
+	err := analyze(*input, *output, report.Format(*format), *window)
+	if err != nil {
+		slog.Error("analyze report", attr.Error(err))
+	}
+}
+
+// analyze streams the report once and writes a WindowStats record per stream
+// and window. Input is expected in roughly timestamp order, as written.
+func analyze(inputPath, outputPath string, format report.Format, window time.Duration) error {
+	if window <= 0 {
+		return fmt.Errorf("window %s is not positive", window)
+	}
+
+	file, err := os.Open(inputPath)
+	if err != nil {
+		return fmt.Errorf("open report: %w", err)
+	}
+	defer file.Close()
+
+	reader, err := report.NewReader(file)
+	if err != nil {
+		return fmt.Errorf("new reader: %w", err)
+	}
+
+	c := newColumns(reader)
+	if c.timestamp < 0 || c.ssrc < 0 {
+		return errors.New("report has no timestamp or ssrc")
+	}
+
+	writer, err := report.NewWriter(outputPath, format, windowStatsSchema, reader.Meta(), 0)
+	if err != nil {
+		return fmt.Errorf("new writer: %w", err)
+	}
+
+	a := &aggregator{
+		columns:    c,
+		windowSize: window.Nanoseconds(),
+		writer:     writer,
+		streams:    map[streamKey]*stream{},
+	}
+
+	values := make([]float64, len(reader.Fields()))
+	for {
+		err = reader.Next(values)
+		if errors.Is(err, io.EOF) {
+			break
+		}
+		if err != nil {
+			_ = writer.Close()
+			return fmt.Errorf("read record: %w", err)
+		}
+
+		if err = a.add(values); err != nil {
+			_ = writer.Close()
+			return err
+		}
+	}
+
+	if err = a.closeIdle(-1); err != nil {
+		_ = writer.Close()
+		return err
+	}
+
+	return writer.Close()
+}
+
+type aggregator struct {
+	columns    columns
+	windowSize int64
+	writer     *report.Writer
+
+	current int64
+	streams map[streamKey]*stream
+}
+
+func (a *aggregator) add(values []float64) error {
+	key := streamKey{session: uint32(value(values, a.columns.session)), ssrc: uint32(values[a.columns.ssrc])}
+	window := int64(values[a.columns.timestamp]) / a.windowSize
+
+	// Streams that ended are written out once a window passes without them.
+	if window > a.current {
+		a.current = window
+		if err := a.closeIdle(window - 1); err != nil {
+			return err
+		}
+	}
+
+	s, ok := a.streams[key]
+	if !ok {
+		s = &stream{window: window}
+		a.streams[key] = s
+	}
+
+	if window > s.window {
+		if err := a.write(key, s); err != nil {
+			return err
+		}
+		s.window = window
+	}
+
+	s.add(a.columns, values)
+	return nil
+}
+
+// closeIdle writes and forgets streams whose window is before the given
+// one, all of them for a negative window.
+func (a *aggregator) closeIdle(before int64) error {
+	keys := make([]streamKey, 0, len(a.streams))
+	for key := range a.streams {
+		keys = append(keys, key)
+	}
+	slices.SortFunc(keys, func(x, y streamKey) int {
+		if x.session != y.session {
+			return cmp.Compare(x.session, y.session)
+		}
+		return cmp.Compare(x.ssrc, y.ssrc)
+	})
+
+	for _, key := range keys {
+		s := a.streams[key]
+		if before >= 0 && s.window >= before {
+			continue
+		}
+		if err := a.write(key, s); err != nil {
+			return err
+		}
+		delete(a.streams, key)
+	}
+	return nil
+}
+
+func (a *aggregator) write(key streamKey, s *stream) error {
+	if s.samples == 0 {
+		return nil
+	}
+	if err := a.writer.Write(s.close(key, a.windowSize, a.columns.received)); err != nil {
+		return fmt.Errorf("write window: %w", err)
+	}
+	return nil
+}
@@ -0,0 +1,252 @@
+package main
+
+import (
+	"bwe/demo/pkg/report"
+	"math"
+)
+
+// WindowStats aggregates the samples of one stream over a window. Rates are
+// per second of sampled time. Delay p50 is averaged over the samples
+// weighted by their delay sample counts, p95 and p99 are the window maxima.
+// Playout fields come from client reports: freezes and their duration are
+// totals over the window, the jitter buffer delay the mean per frame.
+type WindowStats struct {
+	Timestamp      int64   `json:"timestamp"`
+	Session        uint32  `json:"session"`
+	SSRC           uint32  `json:"ssrc"`
+	Samples        uint32  `json:"samples"`
+	Bitrate        float64 `json:"bitrate"`
+	PacketRate     float64 `json:"packet_rate"`
+	LossRate       float64 `json:"loss_rate"`
+	NACKRate       float64 `json:"nack_rate"`
+	PLIRate        float64 `json:"pli_rate"`
+	RoundTripTime  float64 `json:"round_trip_time"`
+	PacketDelayP50 float64 `json:"packet_delay_p50"`
+	PacketDelayP95 float64 `json:"packet_delay_p95"`
+	PacketDelayP99 float64 `json:"packet_delay_p99"`
+	FrameDelayP50  float64 `json:"frame_delay_p50"`
+	FrameDelayP95  float64 `json:"frame_delay_p95"`
+	FrameDelayP99  float64 `json:"frame_delay_p99"`
+
+	FrameRate         float64 `json:"frame_rate"`
+	Freezes           float64 `json:"freezes"`
+	FreezeDuration    float64 `json:"freeze_duration"`
+	JitterBufferDelay float64 `json:"jitter_buffer_delay"`
+}
+
+var windowStatsSchema = []report.Field{
+	{Name: "timestamp", Type: "<i8"},
+	{Name: "session", Type: "<u4"},
+	{Name: "ssrc", Type: "<u4"},
+	{Name: "samples", Type: "<u4"},
+	{Name: "bitrate", Type: "<f8"},
+	{Name: "packet_rate", Type: "<f8"},
+	{Name: "loss_rate", Type: "<f8"},
+	{Name: "nack_rate", Type: "<f8"},
+	{Name: "pli_rate", Type: "<f8"},
+	{Name: "round_trip_time", Type: "<f8"},
+	{Name: "packet_delay_p50", Type: "<f8"},
+	{Name: "packet_delay_p95", Type: "<f8"},
+	{Name: "packet_delay_p99", Type: "<f8"},
+	{Name: "frame_delay_p50", Type: "<f8"},
+	{Name: "frame_delay_p95", Type: "<f8"},
+	{Name: "frame_delay_p99", Type: "<f8"},
+	{Name: "frame_rate", Type: "<f8"},
+	{Name: "freezes", Type: "<f8"},
+	{Name: "freeze_duration", Type: "<f8"},
+	{Name: "jitter_buffer_delay", Type: "<f8"},
+}
+
+func (s WindowStats) AppendBinary(b []byte) []byte {
+	b = report.AppendInt64(b, s.Timestamp)
+	b = report.AppendUint32(b, s.Session)
+	b = report.AppendUint32(b, s.SSRC)
+	b = report.AppendUint32(b, s.Samples)
+	b = report.AppendFloat64(b, s.Bitrate)
+	b = report.AppendFloat64(b, s.PacketRate)
+	b = report.AppendFloat64(b, s.LossRate)
+	b = report.AppendFloat64(b, s.NACKRate)
+	b = report.AppendFloat64(b, s.PLIRate)
+	b = report.AppendFloat64(b, s.RoundTripTime)
+	b = report.AppendFloat64(b, s.PacketDelayP50)
+	b = report.AppendFloat64(b, s.PacketDelayP95)
+	b = report.AppendFloat64(b, s.PacketDelayP99)
+	b = report.AppendFloat64(b, s.FrameDelayP50)
+	b = report.AppendFloat64(b, s.FrameDelayP95)
+	b = report.AppendFloat64(b, s.FrameDelayP99)
+	b = report.AppendFloat64(b, s.FrameRate)
+	b = report.AppendFloat64(b, s.Freezes)
+	b = report.AppendFloat64(b, s.FreezeDuration)
+	b = report.AppendFloat64(b, s.JitterBufferDelay)
+	return b
+}
+
+// columns are the input fields the analyzer uses, -1 when absent. Client
+// reports count received packets, server reports sent ones.
+type columns struct {
+	timestamp, session, ssrc                            int
+	bytes, packets, lost, nack, pli                     int
+	received                                            bool
+	roundTripTime                                       int
+	packetDelaySamples, packetP50, packetP95, packetP99 int
+	frameDelaySamples, frameP50, frameP95, frameP99     int
+	rendered, freezes, freezeDuration, bufferDelay      int
+}
+
+func newColumns(reader *report.Reader) columns {
+	either := func(names ...string) int {
+		for _, name := range names {
+			if i := reader.Index(name); i >= 0 {
+				return i
+			}
+		}
+		return -1
+	}
+
+	return columns{
+		timestamp:          reader.Index("timestamp"),
+		session:            reader.Index("session"),
+		ssrc:               reader.Index("ssrc"),
+		bytes:              either("bytes_received", "bytes_sent"),
+		packets:            either("packets_received", "packets_sent"),
+		received:           reader.Index("packets_received") >= 0,
+		lost:               reader.Index("packets_lost"),
+		nack:               reader.Index("nack_count"),
+		pli:                reader.Index("pli_count"),
+		roundTripTime:      reader.Index("round_trip_time"),
+		packetDelaySamples: reader.Index("packet_delay_samples"),
+		packetP50:          reader.Index("packet_delay_p50"),
+		packetP95:          reader.Index("packet_delay_p95"),
+		packetP99:          reader.Index("packet_delay_p99"),
+		frameDelaySamples:  reader.Index("frame_delay_samples"),
+		frameP50:           reader.Index("frame_delay_p50"),
+		frameP95:           reader.Index("frame_delay_p95"),
+		frameP99:           reader.Index("frame_delay_p99"),
+		rendered:           reader.Index("frames_rendered"),
+		freezes:            reader.Index("freeze_count"),
+		freezeDuration:     reader.Index("total_freezes_duration"),
+		bufferDelay:        reader.Index("jitter_buffer_delay"),
+	}
+}
+
+func value(values []float64, i int) float64 {
+	if i < 0 {
+		return 0
+	}
+	return values[i]
+}
+
+type streamKey struct {
+	session uint32
+	ssrc    uint32
+}
+
+// stream holds the previous sample of a stream and its open window. This
+// is all the state kept, so memory depends on the number of streams only.
+type stream struct {
+	window int64
+	last   []float64
+
+	samples                         uint32
+	seconds                         float64
+	bytes, packets, lost, nack, pli float64
+	roundTripTime                   float64
+	packetDelay, frameDelay         delayWindow
+
+	rendered, freezes, freezeDuration, bufferDelay float64
+}
+
+type delayWindow struct {
+	samples  float64
+	p50      float64
+	p95, p99 float64
+}
+
+func (d *delayWindow) add(samples, p50, p95, p99 float64) {
+	if samples <= 0 {
+		return
+	}
+	d.samples += samples
+	d.p50 += p50 * samples
+	d.p95 = math.Max(d.p95, p95)
+	d.p99 = math.Max(d.p99, p99)
+}
+
+func (d delayWindow) median() float64 {
+	if d.samples == 0 {
+		return 0
+	}
+	return d.p50 / d.samples
+}
+
+// add accounts the sample to the open window. Counter deltas are taken from
+// the previous sample of the stream.
+func (s *stream) add(c columns, values []float64) {
+	s.samples++
+	s.roundTripTime += value(values, c.roundTripTime)
+	s.packetDelay.add(value(values, c.packetDelaySamples), value(values, c.packetP50), value(values, c.packetP95), value(values, c.packetP99))
+	s.frameDelay.add(value(values, c.frameDelaySamples), value(values, c.frameP50), value(values, c.frameP95), value(values, c.frameP99))
+
+	if s.last != nil {
+		delta := func(i int) float64 {
+			if i < 0 {
+				return 0
+			}
+			return max(values[i]-s.last[i], 0)
+		}
+		s.seconds += delta(c.timestamp) / 1e9
+		s.bytes += delta(c.bytes)
+		s.packets += delta(c.packets)
+		s.lost += delta(c.lost)
+		s.nack += delta(c.nack)
+		s.pli += delta(c.pli)
+		s.rendered += delta(c.rendered)
+		s.freezes += delta(c.freezes)
+		s.freezeDuration += delta(c.freezeDuration)
+		s.bufferDelay += delta(c.bufferDelay)
+	} else {
+		s.last = make([]float64, len(values))
+	}
+	copy(s.last, values)
+}
+
+func (s *stream) close(key streamKey, windowSize int64, received bool) WindowStats {
+	stats := WindowStats{
+		Timestamp:      s.window * windowSize,
+		Session:        key.session,
+		SSRC:           key.ssrc,
+		Samples:        s.samples,
+		RoundTripTime:  s.roundTripTime / float64(max(s.samples, 1)),
+		PacketDelayP50: s.packetDelay.median(),
+		PacketDelayP95: s.packetDelay.p95,
+		PacketDelayP99: s.packetDelay.p99,
+		FrameDelayP50:  s.frameDelay.median(),
+		FrameDelayP95:  s.frameDelay.p95,
+		FrameDelayP99:  s.frameDelay.p99,
+		Freezes:        s.freezes,
+		FreezeDuration: s.freezeDuration,
+	}
+
+	if s.seconds > 0 {
+		stats.Bitrate = s.bytes * 8 / s.seconds
+		stats.PacketRate = s.packets / s.seconds
+		stats.NACKRate = s.nack / s.seconds
+		stats.PLIRate = s.pli / s.seconds
+		stats.FrameRate = s.rendered / s.seconds
+	}
+	if s.rendered > 0 {
+		stats.JitterBufferDelay = s.bufferDelay / s.rendered
+	}
+
+	expected := s.packets
+	if received {
+		expected += s.lost
+	}
+	if expected > 0 {
+		stats.LossRate = s.lost / expected
+	}
+
+	last := s.last
+	*s = stream{last: last}
+	return stats
+}
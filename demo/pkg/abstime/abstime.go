@@ -0,0 +1,60 @@
+// Package abstime stamps outgoing RTP packets with abs-send-time and
+// abs-capture-time and turns them back into one-way delays on the receiver.
+package abstime
+
+import (
+	"encoding/binary"
+	"fmt"
+	"time"
+
+	"github.com/pion/sdp/v3"
+	"github.com/pion/webrtc/v4"
+)
+
+const (
+	SendTimeURI    = sdp.ABSSendTimeURI
+	CaptureTimeURI = "http://www.webrtc.org/experiments/rtp-hdrext/abs-capture-time"
+)
+
+// RegisterHeaderExtensions negotiates both extensions for video.
+func RegisterHeaderExtensions(m *webrtc.MediaEngine) error {
+	for _, uri := range []string{SendTimeURI, CaptureTimeURI} {
+		err := m.RegisterHeaderExtension(webrtc.RTPHeaderExtensionCapability{URI: uri}, webrtc.RTPCodecTypeVideo)
+		if err != nil {
+			return fmt.Errorf("register header extension %s: %w", uri, err)
+		}
+	}
+
+	return nil
+}
+
+// ntpEpochOffset is the number of seconds from 1900 to 1970.
+const ntpEpochOffset = 2208988800
+
+// NTPTime converts t to a 64-bit NTP timestamp, 32.32 fixed point seconds.
+func NTPTime(t time.Time) uint64 {
+	seconds := uint64(t.Unix() + ntpEpochOffset)
+	fraction := uint64(t.Nanosecond()) << 32 / uint64(time.Second)
+	return seconds<<32 | fraction
+}
+
+// FromNTPTime is the inverse of NTPTime.
+func FromNTPTime(ntp uint64) time.Time {
+	seconds := int64(ntp>>32) - ntpEpochOffset
+	nanoseconds := (ntp & 0xffffffff) * uint64(time.Second) >> 32
+	return time.Unix(seconds, int64(nanoseconds))
+}
+
+// MarshalCaptureTime encodes the short form of abs-capture-time, without
+// the estimated capture clock offset.
+func MarshalCaptureTime(captureTime time.Time) []byte {
+	return binary.BigEndian.AppendUint64(make([]byte, 0, 8), NTPTime(captureTime))
+}
+
+// UnmarshalCaptureTime decodes the capture timestamp of either form.
+func UnmarshalCaptureTime(payload []byte) (time.Time, bool) {
+	if len(payload) != 8 && len(payload) != 16 {
+		return time.Time{}, false
+	}
+	return FromNTPTime(binary.BigEndian.Uint64(payload)), true
+}
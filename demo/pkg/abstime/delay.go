@@ -0,0 +1,107 @@
+package abstime
+
+import (
+	"slices"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"github.com/pion/rtp"
+	"github.com/pion/webrtc/v4"
+)
+
+const clockOffsetWindow = 16
+
+// ClockOffset estimates the sender clock minus the receiver clock from
+// sender reports. Each report yields the offset minus its one-way delay, so
+// the largest of the recent samples is the estimate. Delays corrected with
+// it exclude the smallest path delay seen in the window, which leaves
+// queueing delay and jitter.
+type ClockOffset struct {
+	mu      sync.Mutex
+	samples []time.Duration
+
+	offset atomic.Int64
+	valid  atomic.Bool
+}
+
+// OnSenderReport adds the NTP time of a sender report received at arrival.
+func (c *ClockOffset) OnSenderReport(ntp uint64, arrival time.Time) {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+
+	if len(c.samples) == clockOffsetWindow {
+		c.samples = append(c.samples[:0], c.samples[1:]...)
+	}
+	c.samples = append(c.samples, FromNTPTime(ntp).Sub(arrival))
+
+	c.offset.Store(int64(slices.Max(c.samples)))
+	c.valid.Store(true)
+}
+
+// Offset returns the estimate, false until the first sender report.
+func (c *ClockOffset) Offset() (time.Duration, bool) {
+	if !c.valid.Load() {
+		return 0, false
+	}
+	return time.Duration(c.offset.Load()), true
+}
+
+// Receiver computes one-way delays of a received stream.
+type Receiver struct {
+	sendTimeID    uint8
+	captureTimeID uint8
+	clock         *ClockOffset
+}
+
+func NewReceiver(extensions []webrtc.RTPHeaderExtensionParameter, clock *ClockOffset) *Receiver {
+	r := &Receiver{clock: clock}
+	for _, extension := range extensions {
+		switch extension.URI {
+		case SendTimeURI:
+			r.sendTimeID = uint8(extension.ID)
+		case CaptureTimeURI:
+			r.captureTimeID = uint8(extension.ID)
+		}
+	}
+	return r
+}
+
+// PacketDelay returns the time from abs-send-time to arrival.
+func (r *Receiver) PacketDelay(header *rtp.Header, arrival time.Time) (time.Duration, bool) {
+	offset, ok := r.clock.Offset()
+	if !ok || r.sendTimeID == 0 {
+		return 0, false
+	}
+
+	payload := header.GetExtension(r.sendTimeID)
+	if payload == nil {
+		return 0, false
+	}
+
+	var extension rtp.AbsSendTimeExtension
+	if err := extension.Unmarshal(payload); err != nil {
+		return 0, false
+	}
+
+	// abs-send-time wraps every 64 seconds and is unwrapped around the
+	// arrival time in the sender clock.
+	senderArrival := arrival.Add(offset)
+	return senderArrival.Sub(extension.Estimate(senderArrival)), true
+}
+
+// FrameDelay returns the time from abs-capture-time to arrival of the last
+// packet of a frame. Other packets return false.
+func (r *Receiver) FrameDelay(header *rtp.Header, arrival time.Time) (time.Duration, bool) {
+	offset, ok := r.clock.Offset()
+	if !ok || r.captureTimeID == 0 || !header.Marker {
+		return 0, false
+	}
+
+	captureTime, ok := UnmarshalCaptureTime(header.GetExtension(r.captureTimeID))
+	if !ok {
+		return 0, false
+	}
+
+	return arrival.Add(offset).Sub(captureTime), true
+}
@@ -0,0 +1,80 @@
+package abstime
+
+import (
+	"slices"
+	"time"
+
+	"github.com/pion/interceptor"
+	"github.com/pion/rtp"
+)
+
+// InterceptorFactory stamps one of the extensions on every local stream
+// that negotiated it. Capture time belongs outside the pacer and send time
+// right before the transport, so they are separate interceptors.
+type InterceptorFactory struct {
+	uri string
+}
+
+// NewCaptureTimeInterceptor stamps all packets of a frame with the time its
+// first packet was written.
+func NewCaptureTimeInterceptor() *InterceptorFactory {
+	return &InterceptorFactory{uri: CaptureTimeURI}
+}
+
+// NewSendTimeInterceptor stamps every packet with the time it is written.
+func NewSendTimeInterceptor() *InterceptorFactory {
+	return &InterceptorFactory{uri: SendTimeURI}
+}
+
+func (f *InterceptorFactory) NewInterceptor(_ string) (interceptor.Interceptor, error) {
+	return &stampInterceptor{uri: f.uri}, nil
+}
+
+type stampInterceptor struct {
+	interceptor.NoOp
+	uri string
+}
+
+func (i *stampInterceptor) BindLocalStream(info *interceptor.StreamInfo, writer interceptor.RTPWriter) interceptor.RTPWriter {
+	var id uint8
+	for _, extension := range info.RTPHeaderExtensions {
+		if extension.URI == i.uri {
+			id = uint8(extension.ID)
+		}
+	}
+	if id == 0 {
+		return writer
+	}
+
+	if i.uri == SendTimeURI {
+		return interceptor.RTPWriterFunc(func(header *rtp.Header, payload []byte, attributes interceptor.Attributes) (int, error) {
+			extension, err := rtp.NewAbsSendTimeExtension(time.Now()).Marshal()
+			if err == nil {
+				err = header.SetExtension(id, extension)
+			}
+			if err != nil {
+				return 0, err
+			}
+			return writer.Write(header, payload, attributes)
+		})
+	}
+
+	var (
+		timestamp   uint32
+		captureTime []byte
+	)
+	return interceptor.RTPWriterFunc(func(header *rtp.Header, payload []byte, attributes interceptor.Attributes) (int, error) {
+		if captureTime == nil || header.Timestamp != timestamp {
+			timestamp = header.Timestamp
+			captureTime = MarshalCaptureTime(time.Now())
+		}
+
+		// Shared tracks write the same header to every binding, give this
+		// one its own extensions before adding to them.
+		header.Extensions = slices.Grow(slices.Clone(header.Extensions), 2)
+		if err := header.SetExtension(id, captureTime); err != nil {
+			return 0, err
+		}
+		return writer.Write(header, payload, attributes)
+	})
+}
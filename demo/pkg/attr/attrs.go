@@ -1,6 +1,7 @@
 package attr
 
 import (
+	"bwe/demo/pkg/pacer"
 	"fmt"
 	"log/slog"
 
@@ -15,6 +16,10 @@ func State[T fmt.Stringer](state T) slog.Attr {
 	return slog.String("state", state.String())
 }
 
+func Session(id int) slog.Attr {
+	return slog.Int("session", id)
+}
+
 func SSRC(ssrc webrtc.SSRC) slog.Attr {
 	return slog.Uint64("ssrc", uint64(ssrc))
 }
@@ -22,3 +27,30 @@ func SSRC(ssrc webrtc.SSRC) slog.Attr {
 func Mid(mid string) slog.Attr {
 	return slog.String("mid", mid)
 }
+
+func Type(typ string) slog.Attr {
+	return slog.String("type", typ)
+}
+
+func Path(path string) slog.Attr {
+	return slog.String("path", path)
+}
+
+func Bitrate(bitrate int) slog.Attr {
+	return slog.Int("bitrate", bitrate)
+}
+
+func Switch(from, to string) slog.Attr {
+	return slog.Group("switch", slog.String("from", from), slog.String("to", to))
+}
+
+func PacerStats(stats pacer.Stats) slog.Attr {
+	return slog.Group("pacer",
+		slog.Uint64("sent", stats.Sent),
+		slog.Uint64("dropped", stats.Dropped),
+		slog.Uint64("probes", stats.Probes),
+		slog.Int("queued", stats.Queued),
+		slog.Duration("queue_delay_avg", stats.QueueDelayAvg),
+		slog.Duration("queue_delay_max", stats.QueueDelayMax),
+	)
+}
@@ -0,0 +1,62 @@
+package client
+
+import (
+	"bwe/demo/pkg/attr"
+	"fmt"
+	"log/slog"
+
+	"github.com/pion/transport/v3"
+)
+
+// Run plays the configured sessions against the server, writes their stats
+// and returns the results. Session i connects over networks[i%len(networks)],
+// no networks means the host's.
+func Run(config Config, networks []transport.Net) ([]SessionResult, error) {
+	if len(networks) == 0 {
+		networks = []transport.Net{nil}
+	}
+
+	pcFactories := make([]PeerConnectionFactory, len(networks))
+	for i, network := range networks {
+		pcFactory, err := newPeerConnectionFactory(config, network)
+		if err != nil {
+			return nil, fmt.Errorf("new peer connection factory: %w", err)
+		}
+		pcFactories[i] = pcFactory
+	}
+
+	report, err := newReport(config)
+	if err != nil {
+		return nil, fmt.Errorf("new report: %w", err)
+	}
+
+	defer func() {
+		err = report.Close()
+		if err != nil {
+			slog.Error("close report", attr.Error(err))
+		}
+
+		slog.Info("report written", slog.Uint64("dropped", report.Dropped()), slog.Uint64("failed", report.Failed()))
+	}()
+
+	packetTrace, err := newTrace(config)
+	if err != nil {
+		return nil, fmt.Errorf("new trace: %w", err)
+	}
+
+	if packetTrace != nil {
+		defer func() {
+			err = packetTrace.Close()
+			if err != nil {
+				slog.Error("close trace", attr.Error(err))
+			}
+
+			slog.Info("trace written", slog.Uint64("dropped", packetTrace.Dropped()))
+		}()
+	}
+
+	results := runSessions(config, pcFactories, report, packetTrace)
+	logSummary(results)
+
+	return results, nil
+}
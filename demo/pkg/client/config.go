@@ -0,0 +1,70 @@
+package client
+
+import (
+	"bwe/demo/pkg/logging"
+	"bwe/demo/pkg/pipeline"
+	"bwe/demo/pkg/report"
+	"fmt"
+	"os"
+	"time"
+
+	"gopkg.in/yaml.v3"
+)
+
+type Config struct {
+	Endpoint        string        `yaml:"endpoint"`
+	IceServer       string        `yaml:"ice_server"`
+	ReportFile      string        `yaml:"report_file"`
+	SessionDuration time.Duration `yaml:"session_duration"`
+	ReportInterval  time.Duration `yaml:"report_interval"`
+
+	// ReportFormat is json or binary. Records are buffered in memory and
+	// written out every ReportFlushInterval or when the buffer fills up.
+	// Up to ReportQueueSize records wait for the writer, newer ones are
+	// dropped and counted.
+	ReportFormat        report.Format `yaml:"report_format"`
+	ReportFlushInterval time.Duration `yaml:"report_flush_interval"`
+	ReportQueueSize     int           `yaml:"report_queue_size"`
+
+	// Sessions above one turn the client into a load generator. Sessions
+	// start RampUpRate per second and last SessionDuration plus a uniform
+	// offset within SessionDurationJitter.
+	Sessions              int           `yaml:"sessions"`
+	RampUpRate            float64       `yaml:"ramp_up_rate"`
+	SessionDurationJitter time.Duration `yaml:"session_duration_jitter"`
+
+	// TraceFile enables the per-packet receive trace. Tracks fill chunks of
+	// TraceChunkSize packets taken from a pool of TraceChunks; packets
+	// arriving while every chunk waits for the writer are dropped.
+	TraceFile      string `yaml:"trace_file"`
+	TraceChunkSize int    `yaml:"trace_chunk_size"`
+	TraceChunks    int    `yaml:"trace_chunks"`
+
+	// Every RenegotiateInterval a session asks the server for a new offer
+	// on its live peer connection, restarting ICE if ICERestart is set, and
+	// logs how long the renegotiation took. Zero disables it.
+	RenegotiateInterval time.Duration `yaml:"renegotiate_interval"`
+	ICERestart          bool          `yaml:"ice_restart"`
+
+	// Pipeline configures the interceptors and is recorded in the report
+	// and trace headers.
+	Pipeline pipeline.Config `yaml:"pipeline"`
+
+	// Log configures the logging backend, which rate limits the messages
+	// sessions repeat.
+	Log logging.Config `yaml:"log"`
+}
+
+func LoadConfig(path string) (Config, error) {
+	configBytes, err := os.ReadFile(path)
+	if err != nil {
+		return Config{}, fmt.Errorf("read file: %w", err)
+	}
+	var config Config
+	err = yaml.Unmarshal(configBytes, &config)
+	if err != nil {
+		return Config{}, fmt.Errorf("yaml unmarshal: %w", err)
+	}
+
+	return config, nil
+}
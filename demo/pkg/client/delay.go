@@ -0,0 +1,39 @@
+package client
+
+import (
+	"slices"
+	"sync"
+	"time"
+)
+
+// delaySamples collects the one-way delays of a track between two stats
+// samples.
+type delaySamples struct {
+	mu      sync.Mutex
+	packets []time.Duration
+	frames  []time.Duration
+}
+
+func (d *delaySamples) addPacket(delay time.Duration) {
+	d.mu.Lock()
+	d.packets = append(d.packets, delay)
+	d.mu.Unlock()
+}
+
+func (d *delaySamples) addFrame(delay time.Duration) {
+	d.mu.Lock()
+	d.frames = append(d.frames, delay)
+	d.mu.Unlock()
+}
+
+// drain returns the delays collected so far, sorted, and starts over.
+func (d *delaySamples) drain() (packets, frames []time.Duration) {
+	d.mu.Lock()
+	packets, d.packets = d.packets, make([]time.Duration, 0, cap(d.packets))
+	frames, d.frames = d.frames, make([]time.Duration, 0, cap(d.frames))
+	d.mu.Unlock()
+
+	slices.Sort(packets)
+	slices.Sort(frames)
+	return packets, frames
+}
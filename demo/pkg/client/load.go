@@ -0,0 +1,132 @@
+package client
+
+import (
+	"bwe/demo/pkg/attr"
+	"bwe/demo/pkg/trace"
+	"log/slog"
+	"math/rand"
+	"slices"
+	"sync"
+	"time"
+)
+
+// runSessions starts config.Sessions sessions, spaced by the ramp-up rate,
+// and waits for all of them to finish. Sessions take turns on the factories.
+func runSessions(config Config, pcFactories []PeerConnectionFactory, report *Report, packetTrace *trace.Writer) []SessionResult {
+	sessions := max(config.Sessions, 1)
+	results := make([]SessionResult, sessions)
+
+	var rampUp time.Duration
+	if config.RampUpRate > 0 {
+		rampUp = time.Duration(float64(time.Second) / config.RampUpRate)
+	}
+
+	var wg sync.WaitGroup
+	for i := 0; i < sessions; i++ {
+		if i > 0 {
+			time.Sleep(rampUp)
+		}
+
+		session := Session{
+			ID:                    i,
+			Config:                config,
+			Duration:              sessionDuration(config),
+			PeerConnectionFactory: pcFactories[i%len(pcFactories)],
+			Report:                report,
+			Trace:                 packetTrace,
+		}
+
+		wg.Add(1)
+		go func(i int) {
+			defer wg.Done()
+			results[i] = session.Run()
+		}(i)
+	}
+	wg.Wait()
+
+	return results
+}
+
+// sessionDuration spreads session ends uniformly over ±SessionDurationJitter.
+func sessionDuration(config Config) time.Duration {
+	if config.SessionDurationJitter <= 0 {
+		return config.SessionDuration
+	}
+
+	jitter := time.Duration(rand.Int63n(int64(2*config.SessionDurationJitter))) - config.SessionDurationJitter
+	return max(config.SessionDuration+jitter, 0)
+}
+
+// logSummary logs receive bitrate and loss per session and over all
+// sessions, together with setup time percentiles.
+func logSummary(results []SessionResult) {
+	var total SessionResult
+	var setups []time.Duration
+	failed := 0
+
+	for _, result := range results {
+		logger := slog.With(attr.Session(result.ID))
+		if result.Err != nil {
+			failed++
+			logger.Error("session failed", attr.Error(result.Err))
+			continue
+		}
+
+		logger.Info("session summary",
+			attr.Bitrate(bitrate(result.BytesReceived, result.Duration)),
+			slog.Float64("loss", loss(result.PacketsReceived, result.PacketsLost)),
+			slog.Duration("setup", result.Setup),
+			slog.Uint64("frames", result.FramesReceived),
+			slog.Uint64("rendered", result.FramesRendered),
+			slog.Uint64("freezes", result.Freezes),
+			slog.Duration("freeze_duration", result.FreezeDuration),
+		)
+
+		total.PacketsReceived += result.PacketsReceived
+		total.PacketsLost += result.PacketsLost
+		total.BytesReceived += result.BytesReceived
+		total.Freezes += result.Freezes
+		total.FreezeDuration += result.FreezeDuration
+		total.Duration = max(total.Duration, result.Duration)
+		if result.FirstFrame {
+			setups = append(setups, result.Setup)
+		}
+	}
+
+	slices.Sort(setups)
+	slog.Info("load summary",
+		slog.Int("sessions", len(results)),
+		slog.Int("failed", failed),
+		slog.Int("no_first_frame", len(results)-failed-len(setups)),
+		attr.Bitrate(bitrate(total.BytesReceived, total.Duration)),
+		slog.Float64("loss", loss(total.PacketsReceived, total.PacketsLost)),
+		slog.Duration("setup_p50", percentile(setups, 0.5)),
+		slog.Duration("setup_p99", percentile(setups, 0.99)),
+		slog.Uint64("freezes", total.Freezes),
+		slog.Duration("freeze_duration", total.FreezeDuration),
+	)
+}
+
+func bitrate(bytes uint64, duration time.Duration) int {
+	if duration <= 0 {
+		return 0
+	}
+	return int(float64(bytes*8) / duration.Seconds())
+}
+
+func loss(received uint64, lost int64) float64 {
+	expected := float64(received) + float64(lost)
+	if expected <= 0 {
+		return 0
+	}
+	return float64(lost) / expected
+}
+
+// percentile returns the nearest-rank percentile of sorted values.
+func percentile(sorted []time.Duration, p float64) time.Duration {
+	if len(sorted) == 0 {
+		return 0
+	}
+	rank := int(p*float64(len(sorted))+0.5) - 1
+	return sorted[min(max(rank, 0), len(sorted)-1)]
+}
@@ -0,0 +1,94 @@
+package client
+
+import (
+	"bwe/demo/pkg/abstime"
+	"bwe/demo/pkg/pipeline"
+	"fmt"
+	"sync"
+
+	"github.com/pion/interceptor"
+	"github.com/pion/interceptor/pkg/stats"
+	"github.com/pion/logging"
+	"github.com/pion/transport/v3"
+	"github.com/pion/webrtc/v4"
+)
+
+// PeerConnectionFactory builds every session's peer connection on one
+// shared webrtc.API and pairs it with its stats getter.
+type PeerConnectionFactory struct {
+	api       *webrtc.API
+	iceServer string
+
+	// The stats interceptor reports getters from inside NewPeerConnection,
+	// so construction is serialized to pair them up.
+	mu     *sync.Mutex
+	getter *stats.Getter
+}
+
+// newPeerConnectionFactory builds a webrtc.API on the network. A nil network
+// uses the host's.
+func newPeerConnectionFactory(config Config, network transport.Net) (PeerConnectionFactory, error) {
+	m := &webrtc.MediaEngine{}
+	err := m.RegisterDefaultCodecs()
+	if err != nil {
+		return PeerConnectionFactory{}, fmt.Errorf("register default codecs: %w", err)
+	}
+
+	err = abstime.RegisterHeaderExtensions(m)
+	if err != nil {
+		return PeerConnectionFactory{}, err
+	}
+
+	ir := &interceptor.Registry{}
+	err = pipeline.Register(m, ir, config.Pipeline)
+	if err != nil {
+		return PeerConnectionFactory{}, fmt.Errorf("register pipeline: %w", err)
+	}
+
+	si, err := stats.NewInterceptor()
+	if err != nil {
+		return PeerConnectionFactory{}, fmt.Errorf("new stats interceptor: %w", err)
+	}
+
+	getter := new(stats.Getter)
+	si.OnNewPeerConnection(func(s string, g stats.Getter) {
+		*getter = g
+	})
+
+	ir.Add(si)
+
+	se := webrtc.SettingEngine{}
+	se.LoggerFactory = logging.NewDefaultLoggerFactory()
+	if network != nil {
+		se.SetNet(network)
+	}
+
+	return PeerConnectionFactory{
+		api:       webrtc.NewAPI(webrtc.WithMediaEngine(m), webrtc.WithInterceptorRegistry(ir), webrtc.WithSettingEngine(se)),
+		iceServer: config.IceServer,
+		mu:        &sync.Mutex{},
+		getter:    getter,
+	}, nil
+}
+
+func (f PeerConnectionFactory) New() (*webrtc.PeerConnection, stats.Getter, error) {
+	f.mu.Lock()
+	defer f.mu.Unlock()
+
+	configuration := webrtc.Configuration{}
+	if f.iceServer != "" {
+		configuration.ICEServers = []webrtc.ICEServer{
+			{
+				URLs: []string{f.iceServer},
+			},
+		}
+	}
+
+	*f.getter = nil
+	pc, err := f.api.NewPeerConnection(configuration)
+	if err != nil {
+		return nil, nil, err
+	}
+
+	return pc, *f.getter, nil
+}
@@ -0,0 +1,309 @@
+package client
+
+import (
+	"cmp"
+	"slices"
+	"sync"
+	"time"
+)
+
+const (
+	videoClockRate = 90000
+
+	// assemblySlots bounds how far back in sequence numbers packets of
+	// unfinished frames are kept.
+	assemblySlots = 1024
+
+	// playoutWindow is the number of recent frames the jitter buffer target
+	// adapts to, playoutQuantile the share of them it waits for.
+	playoutWindow   = 128
+	playoutQuantile = 0.95
+	maxPlayoutDelay = 2 * time.Second
+
+	// A freeze is a gap between rendered frames longer than three times the
+	// recent average frame interval and at least freezeMinExtra longer than
+	// it, as in the freeze metrics of WebRTC.
+	freezeIntervals = 30
+	freezeMinExtra  = 150 * time.Millisecond
+)
+
+// assemblySlot is a received packet waiting for the rest of its frame.
+type assemblySlot struct {
+	used      bool
+	done      bool
+	seq       uint16
+	timestamp uint32
+	marker    bool
+}
+
+// frameAssembler groups RTP packets into frames: a frame is a run of
+// contiguous sequence numbers sharing a timestamp and ending with the marker
+// bit. Without parsing the codec payload the start of a frame is only known
+// from the packet before it, so losing the last packet of a frame also holds
+// back the frames after it until it is retransmitted, and the first frame of
+// a stream is never complete.
+type frameAssembler struct {
+	slots [assemblySlots]assemblySlot
+}
+
+// add inserts a packet and calls completed with the timestamp of every
+// frame it completes: its own and the frames after it that only waited for
+// it to start. Duplicates are ignored.
+func (a *frameAssembler) add(seq uint16, timestamp uint32, marker bool, completed func(uint32)) {
+	slot := &a.slots[seq%assemblySlots]
+	if slot.used && slot.seq == seq {
+		return
+	}
+	*slot = assemblySlot{used: true, seq: seq, timestamp: timestamp, marker: marker}
+
+	for n := 0; n < assemblySlots; n++ {
+		last, ok := a.complete(seq, timestamp)
+		if !ok {
+			return
+		}
+		completed(timestamp)
+
+		seq = last + 1
+		next := &a.slots[seq%assemblySlots]
+		if !next.used || next.seq != seq || next.done {
+			return
+		}
+		timestamp = next.timestamp
+	}
+}
+
+// complete marks the frame with timestamp around seq done if all of its
+// packets are there, and returns its last sequence number.
+func (a *frameAssembler) complete(seq uint16, timestamp uint32) (uint16, bool) {
+	last, ok := a.scan(seq, timestamp, 1)
+	if !ok || !a.slots[last%assemblySlots].marker {
+		return 0, false
+	}
+	first, ok := a.scan(seq, timestamp, -1)
+	if !ok {
+		return 0, false
+	}
+
+	for s := first; ; s++ {
+		a.slots[s%assemblySlots].done = true
+		if s == last {
+			break
+		}
+	}
+	return last, true
+}
+
+// scan walks from seq in direction step over the packets of the frame with
+// timestamp. Forward it stops at the marker, backward at a packet of another
+// frame. It returns the last sequence number of the frame in that direction,
+// false if a packet is missing or the frame was already completed.
+func (a *frameAssembler) scan(seq uint16, timestamp uint32, step int) (uint16, bool) {
+	for n := 0; n < assemblySlots; n++ {
+		slot := &a.slots[seq%assemblySlots]
+		if slot.done {
+			return 0, false
+		}
+		if step > 0 && slot.marker {
+			return seq, true
+		}
+
+		next := seq + uint16(step)
+		neighbour := &a.slots[next%assemblySlots]
+		if !neighbour.used || neighbour.seq != next {
+			return 0, false
+		}
+		if neighbour.timestamp != timestamp {
+			// Forward a new timestamp before the marker means the marker
+			// packet of this frame is lost for good.
+			return seq, step < 0
+		}
+		seq = next
+	}
+	return 0, false
+}
+
+// playout models the receiver side of a track: it assembles frames, holds
+// them in an adaptive jitter buffer and renders them, tracking the quality
+// of experience a viewer would see. Completed frames wait ordered by
+// timestamp and are rendered at their playout deadline, their media time
+// plus the buffer target; the target is the spread of the recent frame
+// delays up to playoutQuantile, so it grows with jitter and shrinks again
+// when the network calms down. A frame completing out of order, after a
+// retransmission for instance, is still rendered if it makes its deadline.
+type playout struct {
+	mu        sync.Mutex
+	opened    time.Time
+	assembler frameAssembler
+
+	// Media time is the unwrapped RTP timestamp relative to the first frame.
+	started       bool
+	lastTimestamp uint32
+	media         int64
+
+	delays []time.Duration
+	sorted []time.Duration
+	lowest time.Duration
+	target time.Duration
+	// pending are the completed frames not rendered yet, by media time.
+	pending  []pendingFrame
+	rendered time.Time
+	// renderedMedia is the media time of the last rendered frame.
+	renderedMedia int64
+	intervals     []time.Duration
+
+	stats playoutStats
+}
+
+// pendingFrame is a completed frame in the jitter buffer.
+type pendingFrame struct {
+	media     int64
+	completed time.Time
+}
+
+// playoutStats are counted since the track opened.
+type playoutStats struct {
+	FramesRendered uint32
+	// FramesDropped counts frames completed after their deadline, once a
+	// later frame was already rendered.
+	FramesDropped  uint32
+	Freezes        uint32
+	FreezeDuration time.Duration
+	// BufferDelay sums the time rendered frames spent completed in the
+	// jitter buffer.
+	BufferDelay time.Duration
+	// FirstFrame is the time from track open to the first rendered frame.
+	FirstFrame time.Duration
+}
+
+func newPlayout(opened time.Time) *playout {
+	return &playout{
+		opened:    opened,
+		delays:    make([]time.Duration, 0, playoutWindow),
+		sorted:    make([]time.Duration, 0, playoutWindow),
+		pending:   make([]pendingFrame, 0, playoutWindow),
+		intervals: make([]time.Duration, 0, freezeIntervals),
+	}
+}
+
+// addPacket feeds a received packet and renders the frames due by its
+// arrival.
+func (p *playout) addPacket(seq uint16, timestamp uint32, marker bool, arrival time.Time) {
+	p.mu.Lock()
+	defer p.mu.Unlock()
+
+	p.assembler.add(seq, timestamp, marker, func(timestamp uint32) {
+		p.complete(timestamp, arrival)
+	})
+	p.release(arrival)
+}
+
+// complete puts a completed frame into the jitter buffer and adapts the
+// target to its delay.
+func (p *playout) complete(timestamp uint32, arrival time.Time) {
+	if !p.started {
+		p.started = true
+		p.lastTimestamp = timestamp
+	}
+	media := p.media + int64(int32(timestamp-p.lastTimestamp))
+	if media > p.media {
+		p.media = media
+		p.lastTimestamp = timestamp
+	}
+
+	if p.stats.FramesRendered > 0 && media <= p.renderedMedia {
+		p.stats.FramesDropped++
+		return
+	}
+
+	// The delay of a frame relative to its media time includes an unknown
+	// constant, which cancels out in the target.
+	delay := arrival.Sub(p.opened) - mediaDuration(media)
+	if len(p.delays) == playoutWindow {
+		p.delays = append(p.delays[:0], p.delays[1:]...)
+	}
+	p.delays = append(p.delays, delay)
+
+	p.sorted = append(p.sorted[:0], p.delays...)
+	slices.Sort(p.sorted)
+	p.lowest = p.sorted[0]
+	p.target = min(percentile(p.sorted, playoutQuantile)-p.lowest, maxPlayoutDelay)
+
+	i, _ := slices.BinarySearchFunc(p.pending, media, func(f pendingFrame, media int64) int {
+		return cmp.Compare(f.media, media)
+	})
+	p.pending = slices.Insert(p.pending, i, pendingFrame{media: media, completed: arrival})
+}
+
+// release renders the pending frames whose deadline passed by now, in
+// media order. A buffer grown past the window renders its oldest frame
+// early rather than growing further.
+func (p *playout) release(now time.Time) {
+	for len(p.pending) > 0 {
+		f := p.pending[0]
+		deadline := p.opened.Add(mediaDuration(f.media) + p.lowest + p.target)
+		if deadline.After(now) && len(p.pending) <= playoutWindow {
+			return
+		}
+		p.pending = p.pending[1:]
+		if deadline.After(now) {
+			deadline = now
+		}
+		p.render(f, deadline)
+	}
+}
+
+// render accounts a frame leaving the jitter buffer at its deadline, or at
+// completion if that was later.
+func (p *playout) render(f pendingFrame, deadline time.Time) {
+	render := deadline
+	if render.Before(f.completed) {
+		render = f.completed
+	}
+
+	if p.stats.FramesRendered == 0 {
+		p.stats.FirstFrame = render.Sub(p.opened)
+	} else {
+		if render.Before(p.rendered) {
+			render = p.rendered
+		}
+		p.addInterval(render.Sub(p.rendered))
+	}
+
+	p.stats.FramesRendered++
+	p.stats.BufferDelay += render.Sub(f.completed)
+	p.rendered = render
+	p.renderedMedia = f.media
+}
+
+func mediaDuration(media int64) time.Duration {
+	return time.Duration(media) * time.Second / videoClockRate
+}
+
+// addInterval accounts the gap between two rendered frames.
+func (p *playout) addInterval(interval time.Duration) {
+	if len(p.intervals) > 0 {
+		var sum time.Duration
+		for _, i := range p.intervals {
+			sum += i
+		}
+		average := sum / time.Duration(len(p.intervals))
+		if interval > max(3*average, average+freezeMinExtra) {
+			p.stats.Freezes++
+			p.stats.FreezeDuration += interval
+		}
+	}
+
+	if len(p.intervals) == freezeIntervals {
+		p.intervals = append(p.intervals[:0], p.intervals[1:]...)
+	}
+	p.intervals = append(p.intervals, interval)
+}
+
+// snapshot renders the frames due by now and returns the counters and the
+// current jitter buffer target.
+func (p *playout) snapshot() (playoutStats, time.Duration) {
+	p.mu.Lock()
+	defer p.mu.Unlock()
+	p.release(time.Now())
+	return p.stats, p.target
+}
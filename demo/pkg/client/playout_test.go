@@ -0,0 +1,124 @@
+package client
+
+import (
+	"testing"
+	"time"
+)
+
+const (
+	testFramePackets = 3
+	testFrameTicks   = 3000
+)
+
+// addPackets adds packets k of frame f, each arriving delay after the media
+// time of the frame.
+func addPackets(p *playout, f int, delay time.Duration, k ...int) {
+	arrival := p.opened.Add(mediaDuration(int64(f*testFrameTicks)) + delay)
+	for _, k := range k {
+		seq := uint16(f*testFramePackets + k)
+		p.addPacket(seq, uint32(f*testFrameTicks), k == testFramePackets-1, arrival)
+	}
+}
+
+func addFrame(p *playout, f int, delay time.Duration) {
+	addPackets(p, f, delay, 0, 1, 2)
+}
+
+// TestPlayoutInOrder checks that frames arriving with a constant delay are
+// rendered as they complete. The first frame is never complete, its start is
+// not known.
+func TestPlayoutInOrder(t *testing.T) {
+	p := newPlayout(time.Now())
+	for f := 0; f < 60; f++ {
+		addFrame(p, f, 10*time.Millisecond)
+	}
+	p.release(p.opened.Add(time.Hour))
+
+	if p.stats.FramesRendered != 59 || p.stats.FramesDropped != 0 || p.stats.Freezes != 0 {
+		t.Fatalf("stats %+v, want 59 rendered and none dropped or frozen", p.stats)
+	}
+	// Media times round to nanoseconds.
+	if p.stats.BufferDelay > time.Microsecond || p.target > time.Microsecond {
+		t.Fatalf("buffer delay %v and target %v without jitter", p.stats.BufferDelay, p.target)
+	}
+	if p.renderedMedia != 58*testFrameTicks {
+		t.Fatalf("last rendered media %d, want %d", p.renderedMedia, 58*testFrameTicks)
+	}
+}
+
+// TestPlayoutRetransmission checks that a frame completed after the next one
+// by a retransmission is still rendered, and first, when the jitter buffer
+// waits long enough for it.
+func TestPlayoutRetransmission(t *testing.T) {
+	p := newPlayout(time.Now())
+	for f := 0; f < 20; f++ {
+		delay := 10 * time.Millisecond
+		if f%2 == 1 {
+			delay = 90 * time.Millisecond
+		}
+		addFrame(p, f, delay)
+	}
+	addFrame(p, 20, 10*time.Millisecond)
+	addPackets(p, 21, 10*time.Millisecond, 0, 2)
+	addFrame(p, 22, 10*time.Millisecond)
+	if p.stats.FramesRendered == 0 || len(p.pending) == 0 {
+		t.Fatalf("frame 22 rendered before its deadline, stats %+v", p.stats)
+	}
+	addPackets(p, 21, 60*time.Millisecond, 1)
+	p.release(p.opened.Add(time.Hour))
+
+	if p.stats.FramesRendered != 22 || p.stats.FramesDropped != 0 {
+		t.Fatalf("stats %+v, want 22 rendered and none dropped", p.stats)
+	}
+}
+
+// TestPlayoutLateFrame checks that a frame completing after a later frame was
+// rendered is dropped.
+func TestPlayoutLateFrame(t *testing.T) {
+	p := newPlayout(time.Now())
+	for f := 0; f < 10; f++ {
+		if f == 5 {
+			addPackets(p, f, 10*time.Millisecond, 0, 2)
+			continue
+		}
+		addFrame(p, f, 10*time.Millisecond)
+	}
+	addPackets(p, 5, 200*time.Millisecond, 1)
+	p.release(p.opened.Add(time.Hour))
+
+	if p.stats.FramesRendered != 8 || p.stats.FramesDropped != 1 {
+		t.Fatalf("stats %+v, want 8 rendered and 1 dropped", p.stats)
+	}
+}
+
+// TestAssemblerCompletes checks that frames complete once all of their
+// packets are there, in any order and across the sequence number wrap, and
+// that duplicates complete nothing.
+func TestAssemblerCompletes(t *testing.T) {
+	var a frameAssembler
+	var completed []uint32
+	add := func(seq uint16, timestamp uint32, marker bool) {
+		a.add(seq, timestamp, marker, func(timestamp uint32) {
+			completed = append(completed, timestamp)
+		})
+	}
+
+	add(65534, 0, true)
+	add(65535, 3000, false)
+	add(0, 3000, true)
+	add(0, 3000, true)
+	add(2, 6000, true)
+	add(1, 6000, false)
+	add(1, 6000, false)
+	if len(completed) != 2 || completed[0] != 3000 || completed[1] != 6000 {
+		t.Fatalf("completed %v, want [3000 6000]", completed)
+	}
+
+	// A frame waiting for the last packet of the one before completes with
+	// it.
+	add(4, 12000, true)
+	add(3, 9000, true)
+	if len(completed) != 4 || completed[2] != 9000 || completed[3] != 12000 {
+		t.Fatalf("completed %v, want 9000 then 12000 appended", completed)
+	}
+}
@@ -0,0 +1,134 @@
+package client
+
+import (
+	"bwe/demo/pkg/report"
+	"bwe/demo/pkg/trace"
+)
+
+type StreamStats struct {
+	Timestamp                   int64   `json:"timestamp"`
+	Session                     int     `json:"session"`
+	SSRC                        uint32  `json:"ssrc"`
+	PacketsReceived             uint64  `json:"packets_received"`
+	PacketsLost                 int64   `json:"packets_lost"`
+	Jitter                      float64 `json:"jitter"`
+	LastPacketReceivedTimestamp int64   `json:"last_packet_received_timestamp"`
+	HeaderBytesReceived         uint64  `json:"header_bytes_received"`
+	BytesReceived               uint64  `json:"bytes_received"`
+	FIRCount                    uint32  `json:"fir_count"`
+	PLICount                    uint32  `json:"pli_count"`
+	NACKCount                   uint32  `json:"nack_count"`
+
+	// One-way delays in seconds since the previous sample, zero without
+	// samples. Packet delays use abs-send-time, frame delays the
+	// abs-capture-time of the last packet of a frame.
+	PacketDelaySamples uint32  `json:"packet_delay_samples"`
+	PacketDelayP50     float64 `json:"packet_delay_p50"`
+	PacketDelayP95     float64 `json:"packet_delay_p95"`
+	PacketDelayP99     float64 `json:"packet_delay_p99"`
+	FrameDelaySamples  uint32  `json:"frame_delay_samples"`
+	FrameDelayP50      float64 `json:"frame_delay_p50"`
+	FrameDelayP95      float64 `json:"frame_delay_p95"`
+	FrameDelayP99      float64 `json:"frame_delay_p99"`
+
+	// Playout of the receiver model, counted since the track opened like
+	// the RTP counters. Durations are in seconds; the jitter buffer delay
+	// sums over rendered frames, and time to first frame is zero until a
+	// frame is rendered.
+	FramesRendered       uint32  `json:"frames_rendered"`
+	FramesDropped        uint32  `json:"frames_dropped"`
+	FreezeCount          uint32  `json:"freeze_count"`
+	TotalFreezesDuration float64 `json:"total_freezes_duration"`
+	JitterBufferDelay    float64 `json:"jitter_buffer_delay"`
+	JitterBufferTarget   float64 `json:"jitter_buffer_target"`
+	TimeToFirstFrame     float64 `json:"time_to_first_frame"`
+}
+
+// StreamStatsSchema lists the StreamStats fields in AppendBinary order.
+var StreamStatsSchema = []report.Field{
+	{Name: "timestamp", Type: "<i8"},
+	{Name: "session", Type: "<u4"},
+	{Name: "ssrc", Type: "<u4"},
+	{Name: "packets_received", Type: "<u8"},
+	{Name: "packets_lost", Type: "<i8"},
+	{Name: "jitter", Type: "<f8"},
+	{Name: "last_packet_received_timestamp", Type: "<i8"},
+	{Name: "header_bytes_received", Type: "<u8"},
+	{Name: "bytes_received", Type: "<u8"},
+	{Name: "fir_count", Type: "<u4"},
+	{Name: "pli_count", Type: "<u4"},
+	{Name: "nack_count", Type: "<u4"},
+	{Name: "packet_delay_samples", Type: "<u4"},
+	{Name: "packet_delay_p50", Type: "<f8"},
+	{Name: "packet_delay_p95", Type: "<f8"},
+	{Name: "packet_delay_p99", Type: "<f8"},
+	{Name: "frame_delay_samples", Type: "<u4"},
+	{Name: "frame_delay_p50", Type: "<f8"},
+	{Name: "frame_delay_p95", Type: "<f8"},
+	{Name: "frame_delay_p99", Type: "<f8"},
+	{Name: "frames_rendered", Type: "<u4"},
+	{Name: "frames_dropped", Type: "<u4"},
+	{Name: "freeze_count", Type: "<u4"},
+	{Name: "total_freezes_duration", Type: "<f8"},
+	{Name: "jitter_buffer_delay", Type: "<f8"},
+	{Name: "jitter_buffer_target", Type: "<f8"},
+	{Name: "time_to_first_frame", Type: "<f8"},
+}
+
+func (s StreamStats) AppendBinary(b []byte) []byte {
+	b = report.AppendInt64(b, s.Timestamp)
+	b = report.AppendUint32(b, uint32(s.Session))
+	b = report.AppendUint32(b, s.SSRC)
+	b = report.AppendUint64(b, s.PacketsReceived)
+	b = report.AppendInt64(b, s.PacketsLost)
+	b = report.AppendFloat64(b, s.Jitter)
+	b = report.AppendInt64(b, s.LastPacketReceivedTimestamp)
+	b = report.AppendUint64(b, s.HeaderBytesReceived)
+	b = report.AppendUint64(b, s.BytesReceived)
+	b = report.AppendUint32(b, s.FIRCount)
+	b = report.AppendUint32(b, s.PLICount)
+	b = report.AppendUint32(b, s.NACKCount)
+	b = report.AppendUint32(b, s.PacketDelaySamples)
+	b = report.AppendFloat64(b, s.PacketDelayP50)
+	b = report.AppendFloat64(b, s.PacketDelayP95)
+	b = report.AppendFloat64(b, s.PacketDelayP99)
+	b = report.AppendUint32(b, s.FrameDelaySamples)
+	b = report.AppendFloat64(b, s.FrameDelayP50)
+	b = report.AppendFloat64(b, s.FrameDelayP95)
+	b = report.AppendFloat64(b, s.FrameDelayP99)
+	b = report.AppendUint32(b, s.FramesRendered)
+	b = report.AppendUint32(b, s.FramesDropped)
+	b = report.AppendUint32(b, s.FreezeCount)
+	b = report.AppendFloat64(b, s.TotalFreezesDuration)
+	b = report.AppendFloat64(b, s.JitterBufferDelay)
+	b = report.AppendFloat64(b, s.JitterBufferTarget)
+	b = report.AppendFloat64(b, s.TimeToFirstFrame)
+	return b
+}
+
+// Report is the stats file shared by all sessions. Sessions push records
+// into a bounded queue drained by a single writer goroutine.
+type Report = report.Queue
+
+func newReport(config Config) (*Report, error) {
+	writer, err := report.NewWriter(config.ReportFile, config.ReportFormat, StreamStatsSchema, config.Pipeline.Meta(), config.ReportFlushInterval)
+	if err != nil {
+		return nil, err
+	}
+
+	return report.NewQueue(writer, config.ReportQueueSize), nil
+}
+
+// newTrace opens the packet trace, or returns nil when it is disabled.
+func newTrace(config Config) (*trace.Writer, error) {
+	if config.TraceFile == "" {
+		return nil, nil
+	}
+
+	writer, err := report.NewWriter(config.TraceFile, report.FormatBinary, trace.Schema, config.Pipeline.Meta(), config.ReportFlushInterval)
+	if err != nil {
+		return nil, err
+	}
+
+	return trace.NewWriter(writer, config.TraceChunkSize, config.TraceChunks), nil
+}
@@ -0,0 +1,422 @@
+package client
+
+import (
+	"bwe/demo/pkg/abstime"
+	"bwe/demo/pkg/attr"
+	"bwe/demo/pkg/signal"
+	"bwe/demo/pkg/trace"
+	"fmt"
+	"log/slog"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"github.com/pion/interceptor/pkg/stats"
+	"github.com/pion/rtcp"
+	"github.com/pion/rtp"
+	"github.com/pion/webrtc/v4"
+	"golang.org/x/net/websocket"
+)
+
+// Session is one viewer: a websocket to the server and the peer connection
+// negotiated over it.
+type Session struct {
+	ID                    int
+	Config                Config
+	Duration              time.Duration
+	PeerConnectionFactory PeerConnectionFactory
+	Report                *Report
+	Trace                 *trace.Writer
+}
+
+// readBuffers are reused across tracks so sessions coming and going under
+// load do not allocate a buffer per track.
+var readBuffers = sync.Pool{
+	New: func() any {
+		buffer := make([]byte, 8000)
+		return &buffer
+	},
+}
+
+// SessionResult sums up a finished session.
+type SessionResult struct {
+	ID              int
+	Duration        time.Duration
+	Setup           time.Duration
+	FirstFrame      bool
+	PacketsReceived uint64
+	FramesReceived  uint64
+	FramesRendered  uint64
+	Freezes         uint64
+	FreezeDuration  time.Duration
+	PacketsLost     int64
+	BytesReceived   uint64
+	Err             error
+}
+
+func (s Session) Run() SessionResult {
+	result := SessionResult{ID: s.ID}
+	logger := slog.With(attr.Session(s.ID))
+	setup := signal.NewSetupTimer(logger)
+
+	wsConfig, err := websocket.NewConfig(s.Config.Endpoint, "http://localhost")
+	if err != nil {
+		result.Err = fmt.Errorf("new ws config: %w", err)
+		return result
+	}
+
+	ws, err := websocket.DialConfig(wsConfig)
+	if err != nil {
+		result.Err = fmt.Errorf("dial ws: %w", err)
+		return result
+	}
+
+	defer func() {
+		err = ws.Close()
+		if err != nil {
+			logger.Error("close ws", attr.Error(err))
+		}
+	}()
+
+	pc, statsGetter, err := s.PeerConnectionFactory.New()
+	if err != nil {
+		result.Err = fmt.Errorf("new peer connection: %w", err)
+		return result
+	}
+
+	defer func() {
+		err = pc.Close()
+		if err != nil {
+			logger.Error("close peer connection", attr.Error(err))
+		}
+	}()
+
+	pc.OnSignalingStateChange(func(state webrtc.SignalingState) {
+		logger.Info("signaling state changed", attr.State(state))
+	})
+
+	pc.OnICEGatheringStateChange(func(state webrtc.ICEGatheringState) {
+		logger.Info("ice gathering state changed", attr.State(state))
+	})
+
+	pc.OnICEConnectionStateChange(func(state webrtc.ICEConnectionState) {
+		logger.Info("ice connection state changed", attr.State(state))
+		if state == webrtc.ICEConnectionStateConnected {
+			setup.Mark("ice_connected")
+		}
+	})
+
+	pc.OnConnectionStateChange(func(state webrtc.PeerConnectionState) {
+		logger.Info("connection state changed", attr.State(state))
+
+		if state == webrtc.PeerConnectionStateFailed || state == webrtc.PeerConnectionStateClosed {
+			return
+		}
+	})
+
+	var ssrcs ssrcSet
+	var framesReceived atomic.Uint64
+	var trackDelays sync.Map
+	var trackPlayouts sync.Map
+	clock := &abstime.ClockOffset{}
+
+	pc.OnTrack(func(remote *webrtc.TrackRemote, receiver *webrtc.RTPReceiver) {
+		ssrc := remote.SSRC()
+		mid := receiver.RTPTransceiver().Mid()
+
+		logger.Info("track opened", attr.SSRC(ssrc), attr.Mid(mid))
+
+		delays := &delaySamples{}
+		trackDelays.Store(ssrc, delays)
+		player := newPlayout(time.Now())
+		trackPlayouts.Store(ssrc, player)
+		ssrcs.Add(ssrc)
+
+		defer func() {
+			logger.Info("track closed", attr.SSRC(ssrc), attr.Mid(mid))
+
+			ssrcs.Remove(ssrc)
+		}()
+
+		buffer := readBuffers.Get().(*[]byte)
+		defer readBuffers.Put(buffer)
+
+		go readSenderReports(receiver, clock)
+		delay := abstime.NewReceiver(receiver.GetParameters().HeaderExtensions, clock)
+		var header rtp.Header
+
+		var recorder *trace.Recorder
+		if s.Trace != nil {
+			recorder = s.Trace.NewRecorder(s.ID)
+			defer recorder.Close()
+		}
+
+		for first := true; ; first = false {
+			n, _, err := remote.Read(*buffer)
+			if err != nil {
+				logger.Error("read remote track", attr.Error(err))
+				return
+			}
+			arrival := time.Now()
+			if first {
+				setup.Log("first_frame")
+			}
+			if recorder != nil {
+				if packet, ok := trace.Parse((*buffer)[:n], arrival); ok {
+					recorder.Record(packet)
+				}
+			}
+			if _, err := header.Unmarshal((*buffer)[:n]); err != nil {
+				continue
+			}
+			if header.Marker {
+				framesReceived.Add(1)
+			}
+			player.addPacket(header.SequenceNumber, header.Timestamp, header.Marker, arrival)
+			if packetDelay, ok := delay.PacketDelay(&header, arrival); ok {
+				delays.addPacket(packetDelay)
+			}
+			if frameDelay, ok := delay.FrameDelay(&header, arrival); ok {
+				delays.addFrame(frameDelay)
+			}
+		}
+	})
+
+	// The sampler and the renegotiation ticker are joined before Run
+	// returns, so none pushes to the report after the client closed it.
+	var workers sync.WaitGroup
+	defer workers.Wait()
+	reportDone := make(chan struct{})
+	defer close(reportDone)
+
+	workers.Add(1)
+	go func() {
+		defer workers.Done()
+		ticker := time.NewTicker(s.Config.ReportInterval)
+		defer ticker.Stop()
+		for {
+			select {
+			case <-reportDone:
+				return
+			case <-ticker.C:
+			}
+
+			dropped := 0
+			for _, ssrc := range ssrcs.Open() {
+				rawStats := statsGetter.Get(uint32(ssrc))
+				if rawStats == nil {
+					logger.Error("stats not found", attr.SSRC(ssrc))
+					continue
+				}
+				delays, _ := trackDelays.Load(ssrc)
+				player, _ := trackPlayouts.Load(ssrc)
+				if !s.Report.Push(newStreamStats(s.ID, ssrc, rawStats, delays.(*delaySamples), player.(*playout))) {
+					dropped++
+				}
+			}
+			if dropped > 0 {
+				logger.Warn("report queue full", slog.Int("dropped", dropped))
+			}
+		}
+	}()
+
+	signalConn := signal.NewConn(ws)
+	pc.OnICECandidate(func(candidate *webrtc.ICECandidate) {
+		if err := signalConn.SendCandidate(candidate); err != nil {
+			logger.Error("send local candidate", attr.Error(err))
+		}
+	})
+
+	offer, err := signalConn.Receive()
+	if err != nil {
+		result.Err = fmt.Errorf("receive offer: %w", err)
+		return result
+	}
+	if offer.Type == signal.TypeError {
+		result.Err = fmt.Errorf("session refused: %s", offer.Error)
+		return result
+	}
+	setup.Mark("offer")
+
+	err = pc.SetRemoteDescription(offer.SessionDescription())
+	if err != nil {
+		result.Err = fmt.Errorf("set remote description: %w", err)
+		return result
+	}
+
+	answer, err := pc.CreateAnswer(nil)
+	if err != nil {
+		result.Err = fmt.Errorf("create answer: %w", err)
+		return result
+	}
+
+	err = pc.SetLocalDescription(answer)
+	if err != nil {
+		result.Err = fmt.Errorf("set local description: %w", err)
+		return result
+	}
+
+	err = signalConn.SendDescription(answer)
+	if err != nil {
+		result.Err = fmt.Errorf("send local description: %w", err)
+		return result
+	}
+	setup.Mark("answer")
+
+	// requested is when the outstanding renegotiation was asked for, zero
+	// if there is none.
+	var requested atomic.Int64
+	go func() {
+		for {
+			message, err := signalConn.Receive()
+			if err != nil {
+				return
+			}
+
+			switch message.Type {
+			case signal.TypeCandidate:
+				if message.Candidate == nil {
+					continue
+				}
+				err = pc.AddICECandidate(*message.Candidate)
+				if err != nil {
+					logger.Error("add remote candidate", attr.Error(err))
+				}
+			case signal.TypeOffer:
+				if err := answerOffer(pc, signalConn, message); err != nil {
+					logger.Error("renegotiate", attr.Error(err))
+					return
+				}
+				if start := requested.Swap(0); start != 0 {
+					logger.Info("renegotiated", slog.Duration("elapsed", time.Since(time.Unix(0, start))))
+				}
+			case signal.TypeError:
+				requested.Store(0)
+				logger.Warn("renegotiation refused", slog.String("reason", message.Error))
+			default:
+				logger.Error("unexpected signaling message", attr.Type(message.Type))
+			}
+		}
+	}()
+
+	if s.Config.RenegotiateInterval > 0 {
+		workers.Add(1)
+		go func() {
+			defer workers.Done()
+			ticker := time.NewTicker(s.Config.RenegotiateInterval)
+			defer ticker.Stop()
+			for {
+				select {
+				case <-reportDone:
+					return
+				case <-ticker.C:
+				}
+
+				if !requested.CompareAndSwap(0, time.Now().UnixNano()) {
+					continue
+				}
+				if err := signalConn.SendRenegotiate(s.Config.ICERestart, nil); err != nil {
+					logger.Error("request renegotiation", attr.Error(err))
+					return
+				}
+			}
+		}()
+	}
+
+	time.Sleep(s.Duration)
+	result.Duration = s.Duration
+	result.Setup, result.FirstFrame = setup.Stage("first_frame")
+	result.FramesReceived = framesReceived.Load()
+	trackPlayouts.Range(func(_, value any) bool {
+		rendering, _ := value.(*playout).snapshot()
+		result.FramesRendered += uint64(rendering.FramesRendered)
+		result.Freezes += uint64(rendering.Freezes)
+		result.FreezeDuration += rendering.FreezeDuration
+		return true
+	})
+
+	for _, ssrc := range ssrcs.Seen() {
+		rawStats := statsGetter.Get(uint32(ssrc))
+		if rawStats == nil {
+			continue
+		}
+		result.PacketsReceived += rawStats.InboundRTPStreamStats.PacketsReceived
+		result.PacketsLost += rawStats.InboundRTPStreamStats.PacketsLost
+		result.BytesReceived += rawStats.BytesReceived
+	}
+
+	return result
+}
+
+// answerOffer answers a renegotiation offer of the server on the live peer
+// connection.
+func answerOffer(pc *webrtc.PeerConnection, signalConn *signal.Conn, offer signal.Message) error {
+	err := pc.SetRemoteDescription(offer.SessionDescription())
+	if err != nil {
+		return fmt.Errorf("set remote description: %w", err)
+	}
+
+	answer, err := pc.CreateAnswer(nil)
+	if err != nil {
+		return fmt.Errorf("create answer: %w", err)
+	}
+
+	signalConn.HoldCandidates()
+	err = pc.SetLocalDescription(answer)
+	if err != nil {
+		return fmt.Errorf("set local description: %w", err)
+	}
+
+	return signalConn.SendDescription(answer)
+}
+
+// readSenderReports feeds the sender clock estimate until the receiver stops.
+func readSenderReports(receiver *webrtc.RTPReceiver, clock *abstime.ClockOffset) {
+	for {
+		packets, _, err := receiver.ReadRTCP()
+		if err != nil {
+			return
+		}
+
+		for _, packet := range packets {
+			if senderReport, ok := packet.(*rtcp.SenderReport); ok {
+				clock.OnSenderReport(senderReport.NTPTime, time.Now())
+			}
+		}
+	}
+}
+
+func newStreamStats(session int, ssrc webrtc.SSRC, rawStats *stats.Stats, delays *delaySamples, player *playout) StreamStats {
+	packetDelays, frameDelays := delays.drain()
+	rendering, target := player.snapshot()
+
+	return StreamStats{
+		Timestamp:                   time.Now().UnixNano(),
+		Session:                     session,
+		SSRC:                        uint32(ssrc),
+		PacketsReceived:             rawStats.InboundRTPStreamStats.PacketsReceived,
+		PacketsLost:                 rawStats.InboundRTPStreamStats.PacketsLost,
+		Jitter:                      rawStats.InboundRTPStreamStats.Jitter,
+		LastPacketReceivedTimestamp: rawStats.LastPacketReceivedTimestamp.UnixNano(),
+		HeaderBytesReceived:         rawStats.HeaderBytesReceived,
+		BytesReceived:               rawStats.BytesReceived,
+		FIRCount:                    rawStats.InboundRTPStreamStats.FIRCount,
+		PLICount:                    rawStats.InboundRTPStreamStats.PLICount,
+		NACKCount:                   rawStats.InboundRTPStreamStats.NACKCount,
+		PacketDelaySamples:          uint32(len(packetDelays)),
+		PacketDelayP50:              percentile(packetDelays, 0.50).Seconds(),
+		PacketDelayP95:              percentile(packetDelays, 0.95).Seconds(),
+		PacketDelayP99:              percentile(packetDelays, 0.99).Seconds(),
+		FrameDelaySamples:           uint32(len(frameDelays)),
+		FrameDelayP50:               percentile(frameDelays, 0.50).Seconds(),
+		FrameDelayP95:               percentile(frameDelays, 0.95).Seconds(),
+		FrameDelayP99:               percentile(frameDelays, 0.99).Seconds(),
+		FramesRendered:              rendering.FramesRendered,
+		FramesDropped:               rendering.FramesDropped,
+		FreezeCount:                 rendering.Freezes,
+		TotalFreezesDuration:        rendering.FreezeDuration.Seconds(),
+		JitterBufferDelay:           rendering.BufferDelay.Seconds(),
+		JitterBufferTarget:          target.Seconds(),
+		TimeToFirstFrame:            rendering.FirstFrame.Seconds(),
+	}
+}
@@ -0,0 +1,52 @@
+package client
+
+import (
+	"slices"
+	"sync"
+	"sync/atomic"
+
+	"github.com/pion/webrtc/v4"
+)
+
+// ssrcSet tracks the SSRCs of open tracks. Updates copy the set, so the
+// stats sampler reads a snapshot without taking a lock.
+type ssrcSet struct {
+	mu   sync.Mutex
+	open atomic.Pointer[[]webrtc.SSRC]
+	seen []webrtc.SSRC
+}
+
+func (s *ssrcSet) Add(ssrc webrtc.SSRC) {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+
+	open := append(slices.Clone(s.Open()), ssrc)
+	s.open.Store(&open)
+	s.seen = append(s.seen, ssrc)
+}
+
+func (s *ssrcSet) Remove(ssrc webrtc.SSRC) {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+
+	open := slices.DeleteFunc(slices.Clone(s.Open()), func(o webrtc.SSRC) bool {
+		return o == ssrc
+	})
+	s.open.Store(&open)
+}
+
+// Open returns the SSRCs of open tracks. The slice must not be modified.
+func (s *ssrcSet) Open() []webrtc.SSRC {
+	open := s.open.Load()
+	if open == nil {
+		return nil
+	}
+	return *open
+}
+
+// Seen returns every SSRC added so far.
+func (s *ssrcSet) Seen() []webrtc.SSRC {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	return slices.Clone(s.seen)
+}
@@ -0,0 +1,135 @@
+// Package emulation connects the server and its clients over an in-process
+// virtual network with scripted downlinks.
+package emulation
+
+import (
+	"fmt"
+	"net"
+	"time"
+
+	"github.com/pion/logging"
+	"github.com/pion/transport/v3/vnet"
+)
+
+// Config describes the network between the server and its clients. Delay
+// and jitter apply to every packet in both directions.
+type Config struct {
+	Delay  time.Duration `yaml:"delay"`
+	Jitter time.Duration `yaml:"jitter"`
+	Seed   int64         `yaml:"seed"`
+	// Client i receives over Links[i%len(Links)], without links downlinks
+	// are not shaped.
+	Links []LinkConfig `yaml:"links"`
+}
+
+const (
+	cidr     = "10.0.0.0/16"
+	serverIP = "10.0.0.1"
+)
+
+func clientIP(i int) string {
+	return fmt.Sprintf("10.0.%d.%d", 1+i/250, 1+i%250)
+}
+
+// Network is the emulated network. Server and Clients are passed to the
+// peer connection factories.
+type Network struct {
+	Server  *vnet.Net
+	Clients []*vnet.Net
+
+	router *vnet.Router
+	links  map[string]*link
+	done   chan struct{}
+}
+
+func New(config Config, clients int) (*Network, error) {
+	router, err := vnet.NewRouter(&vnet.RouterConfig{
+		CIDR:          cidr,
+		MinDelay:      config.Delay,
+		MaxJitter:     config.Jitter,
+		LoggerFactory: logging.NewDefaultLoggerFactory(),
+	})
+	if err != nil {
+		return nil, fmt.Errorf("new router: %w", err)
+	}
+
+	n := &Network{
+		router: router,
+		links:  map[string]*link{},
+		done:   make(chan struct{}),
+	}
+
+	n.Server, err = vnet.NewNet(&vnet.NetConfig{StaticIPs: []string{serverIP}})
+	if err != nil {
+		return nil, fmt.Errorf("new server net: %w", err)
+	}
+	if err = router.AddNet(n.Server); err != nil {
+		return nil, fmt.Errorf("add server net: %w", err)
+	}
+
+	for i := 0; i < clients; i++ {
+		ip := clientIP(i)
+		clientNet, err := vnet.NewNet(&vnet.NetConfig{StaticIPs: []string{ip}})
+		if err != nil {
+			return nil, fmt.Errorf("new client net %s: %w", ip, err)
+		}
+		n.Clients = append(n.Clients, clientNet)
+
+		if len(config.Links) == 0 {
+			if err = router.AddNet(clientNet); err != nil {
+				return nil, fmt.Errorf("add client net %s: %w", ip, err)
+			}
+			continue
+		}
+
+		l, err := newLink(clientNet, config.Links[i%len(config.Links)], config.Seed+int64(i))
+		if err != nil {
+			return nil, fmt.Errorf("new link %s: %w", ip, err)
+		}
+		if err = router.AddNet(l.tbf); err != nil {
+			return nil, fmt.Errorf("add client link %s: %w", ip, err)
+		}
+		n.links[ip] = l
+	}
+
+	router.AddChunkFilter(n.filter)
+
+	return n, nil
+}
+
+// filter drops packets according to the loss model of their downlink.
+func (n *Network) filter(chunk vnet.Chunk) bool {
+	addr, ok := chunk.DestinationAddr().(*net.UDPAddr)
+	if !ok {
+		return true
+	}
+
+	l, ok := n.links[addr.IP.String()]
+	if !ok {
+		return true
+	}
+
+	return !l.drop()
+}
+
+// Start starts routing and the link scripts. Step times count from here.
+func (n *Network) Start() error {
+	err := n.router.Start()
+	if err != nil {
+		return fmt.Errorf("start router: %w", err)
+	}
+
+	for _, l := range n.links {
+		go l.run(n.done)
+	}
+
+	return nil
+}
+
+func (n *Network) Close() error {
+	close(n.done)
+	for _, l := range n.links {
+		_ = l.tbf.Close()
+	}
+	return n.router.Stop()
+}
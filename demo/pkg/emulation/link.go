@@ -0,0 +1,114 @@
+package emulation
+
+import (
+	"fmt"
+	"math/rand"
+	"sync"
+	"time"
+
+	"github.com/pion/transport/v3/vnet"
+)
+
+// LinkConfig is the downlink of a client: a token bucket with a bounded
+// queue, followed by a loss model. Steps change the rate and loss over time.
+type LinkConfig struct {
+	QueueSize int    `yaml:"queue_size"`
+	MaxBurst  int    `yaml:"max_burst"`
+	Steps     []Step `yaml:"steps"`
+}
+
+// Step applies At after the network starts. Bandwidth is in bits per second,
+// zero leaves the link uncapped. Loss drops packets independently. Bursts
+// follow a Gilbert model: a packet starts a burst with BurstStart, and every
+// packet of a burst is lost and ends it with BurstEnd.
+type Step struct {
+	At         time.Duration `yaml:"at"`
+	Bandwidth  int           `yaml:"bandwidth"`
+	Loss       float64       `yaml:"loss"`
+	BurstStart float64       `yaml:"burst_start"`
+	BurstEnd   float64       `yaml:"burst_end"`
+}
+
+const uncapped = 10_000_000_000
+
+type link struct {
+	config LinkConfig
+	tbf    *vnet.TokenBucketFilter
+
+	mu       sync.Mutex
+	step     Step
+	bursting bool
+	rand     *rand.Rand
+}
+
+func newLink(nic vnet.NIC, config LinkConfig, seed int64) (*link, error) {
+	var step Step
+	if len(config.Steps) > 0 && config.Steps[0].At <= 0 {
+		step = config.Steps[0]
+	}
+
+	options := []vnet.TBFOption{vnet.TBFRate(rate(step))}
+	if config.QueueSize > 0 {
+		options = append(options, vnet.TBFQueueSizeInBytes(config.QueueSize))
+	}
+	if config.MaxBurst > 0 {
+		options = append(options, vnet.TBFMaxBurst(config.MaxBurst))
+	}
+
+	tbf, err := vnet.NewTokenBucketFilter(nic, options...)
+	if err != nil {
+		return nil, fmt.Errorf("new token bucket filter: %w", err)
+	}
+
+	return &link{
+		config: config,
+		tbf:    tbf,
+		step:   step,
+		rand:   rand.New(rand.NewSource(seed)),
+	}, nil
+}
+
+func rate(step Step) int {
+	if step.Bandwidth <= 0 {
+		return uncapped
+	}
+	return step.Bandwidth
+}
+
+// run applies the steps on schedule until done is closed.
+func (l *link) run(done <-chan struct{}) {
+	start := time.Now()
+	for _, step := range l.config.Steps {
+		timer := time.NewTimer(time.Until(start.Add(step.At)))
+		select {
+		case <-done:
+			timer.Stop()
+			return
+		case <-timer.C:
+		}
+
+		l.tbf.Set(vnet.TBFRate(rate(step)))
+
+		l.mu.Lock()
+		l.step = step
+		l.bursting = false
+		l.mu.Unlock()
+	}
+}
+
+func (l *link) drop() bool {
+	l.mu.Lock()
+	defer l.mu.Unlock()
+
+	if l.bursting {
+		if l.rand.Float64() >= l.step.BurstEnd {
+			return true
+		}
+		l.bursting = false
+	} else if l.step.BurstStart > 0 && l.rand.Float64() < l.step.BurstStart {
+		l.bursting = true
+		return true
+	}
+
+	return l.step.Loss > 0 && l.rand.Float64() < l.step.Loss
+}
@@ -0,0 +1,436 @@
+// Package framestore keeps IVF files in memory with a frame index so that
+// every session streams from one shared copy instead of reopening and
+// reparsing the file.
+package framestore
+
+import (
+	"cmp"
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"io"
+	"os"
+	"slices"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"github.com/pion/webrtc/v4/pkg/media/ivfreader"
+)
+
+const (
+	ivfFileHeaderSize  = 32
+	ivfFrameHeaderSize = 12
+)
+
+// Frame locates a single frame inside the video buffer.
+type Frame struct {
+	Offset    int
+	Size      int
+	Timestamp uint64
+	Keyframe  bool
+}
+
+// Video is an IVF file read into memory with a frame index built once at
+// load. It is immutable after load and safe for concurrent use.
+//
+// A video is reference counted so that a reloaded file can replace it while
+// sessions still stream it. Load returns it with one reference; the last
+// Release frees it. The file is copied rather than mapped, so rewriting it
+// in place never changes or truncates a version still in use.
+type Video struct {
+	Path   string
+	Header ivfreader.IVFFileHeader
+
+	data   []byte
+	size   int
+	frames []Frame
+	// frameDuration is the average time between frame timestamps.
+	frameDuration time.Duration
+
+	// modTime and fileSize identify the version of the file.
+	modTime  time.Time
+	fileSize int64
+	refs     atomic.Int64
+	// store is set once the video was published to a store.
+	store *Store
+}
+
+// FrameCount returns the number of frames in the video.
+func (v *Video) FrameCount() int {
+	return len(v.frames)
+}
+
+// FrameInfo returns the index entry of the i-th frame.
+func (v *Video) FrameInfo(i int) Frame {
+	return v.frames[i]
+}
+
+// Frame returns the payload of the i-th frame. The slice borrows the file
+// data and must not be modified.
+func (v *Video) Frame(i int) []byte {
+	f := v.frames[i]
+	return v.data[f.Offset : f.Offset+f.Size : f.Offset+f.Size]
+}
+
+// Seek returns the last frame with a timestamp at or before timestamp, in
+// timebase units.
+func (v *Video) Seek(timestamp uint64) int {
+	i, found := slices.BinarySearchFunc(v.frames, timestamp, func(f Frame, timestamp uint64) int {
+		return cmp.Compare(f.Timestamp, timestamp)
+	})
+	if found || i == 0 {
+		return i
+	}
+	return i - 1
+}
+
+// KeyframeBefore returns the last keyframe at or before frame i, or 0 if
+// there is none.
+func (v *Video) KeyframeBefore(i int) int {
+	for ; i > 0; i-- {
+		if v.frames[i].Keyframe {
+			return i
+		}
+	}
+	return 0
+}
+
+// KeyframeAfter returns the first keyframe after frame i, or -1 if there is
+// none.
+func (v *Video) KeyframeAfter(i int) int {
+	for i++; i < len(v.frames); i++ {
+		if v.frames[i].Keyframe {
+			return i
+		}
+	}
+	return -1
+}
+
+// FirstKeyframe returns the frame playback loops back to.
+func (v *Video) FirstKeyframe() int {
+	for i, f := range v.frames {
+		if f.Keyframe {
+			return i
+		}
+	}
+	return 0
+}
+
+// Next returns the frame after i, looping back to the first keyframe after
+// the last frame.
+func (v *Video) Next(i int) int {
+	if i+1 < len(v.frames) {
+		return i + 1
+	}
+	return v.FirstKeyframe()
+}
+
+// FrameDuration returns how long the i-th frame is presented: the time to
+// the timestamp of the next frame, or the average frame duration for the
+// last frame and timestamps that do not increase.
+func (v *Video) FrameDuration(i int) time.Duration {
+	if i+1 < len(v.frames) && v.frames[i+1].Timestamp > v.frames[i].Timestamp {
+		return v.ticks(v.frames[i+1].Timestamp - v.frames[i].Timestamp)
+	}
+	return v.frameDuration
+}
+
+// ticks converts a timestamp difference in timebase units to a duration.
+func (v *Video) ticks(n uint64) time.Duration {
+	return time.Duration(n) * time.Second * time.Duration(v.Header.TimebaseNumerator) / time.Duration(v.Header.TimebaseDenominator)
+}
+
+// Size returns the total payload size in bytes.
+func (v *Video) Size() int {
+	return v.size
+}
+
+// Duration returns the playback duration by the frame timestamps, the last
+// frame lasting the average frame duration.
+func (v *Video) Duration() time.Duration {
+	if len(v.frames) == 0 {
+		return 0
+	}
+	return v.ticks(v.frames[len(v.frames)-1].Timestamp-v.frames[0].Timestamp) + v.frameDuration
+}
+
+// Bitrate returns the average payload bitrate in bits per second.
+func (v *Video) Bitrate() int {
+	duration := v.Duration()
+	if duration == 0 {
+		return 0
+	}
+	return int(float64(v.size*8) / duration.Seconds())
+}
+
+// Close drops the file data. Frames returned before must not be used after.
+func (v *Video) Close() error {
+	v.data = nil
+	return nil
+}
+
+// Acquire takes a reference to the video. It fails once the last reference
+// was released, the frames are then gone.
+func (v *Video) Acquire() bool {
+	for {
+		n := v.refs.Load()
+		if n <= 0 {
+			return false
+		}
+		if v.refs.CompareAndSwap(n, n+1) {
+			return true
+		}
+	}
+}
+
+// Release drops a reference. The last one closes the video and tells the
+// store it was published to.
+func (v *Video) Release() {
+	if v.refs.Add(-1) != 0 {
+		return
+	}
+	if v.store != nil {
+		v.store.released(v)
+	}
+	_ = v.Close()
+}
+
+// Resume returns the frame of v to continue at in place of frame i of old,
+// an earlier version of the same video: the first keyframe at or after the
+// same time since the start, or the first keyframe if there is none.
+func (v *Video) Resume(old *Video, i int) int {
+	if len(old.frames) == 0 || len(v.frames) == 0 {
+		return v.FirstKeyframe()
+	}
+	at := old.ticks(old.frames[i].Timestamp - old.frames[0].Timestamp)
+	for j, f := range v.frames {
+		if f.Keyframe && v.ticks(f.Timestamp-v.frames[0].Timestamp) >= at {
+			return j
+		}
+	}
+	return v.FirstKeyframe()
+}
+
+// Load reads the IVF file at path and indexes its frames. A file written
+// while it is read fails to load.
+func Load(path string) (*Video, error) {
+	file, err := os.Open(path)
+	if err != nil {
+		return nil, fmt.Errorf("open file: %w", err)
+	}
+	defer file.Close()
+
+	info, err := file.Stat()
+	if err != nil {
+		return nil, fmt.Errorf("stat file: %w", err)
+	}
+
+	data := make([]byte, info.Size())
+	if _, err = io.ReadFull(file, data); err != nil {
+		return nil, fmt.Errorf("read file: %w", err)
+	}
+	after, err := file.Stat()
+	if err != nil {
+		return nil, fmt.Errorf("stat file: %w", err)
+	}
+	if after.Size() != info.Size() || !after.ModTime().Equal(info.ModTime()) {
+		return nil, errors.New("file changed while reading")
+	}
+
+	video, err := index(path, data)
+	if err != nil {
+		return nil, err
+	}
+	video.modTime = info.ModTime()
+	video.fileSize = info.Size()
+	video.refs.Store(1)
+	return video, nil
+}
+
+// index parses the IVF file header and the frame headers that follow it.
+func index(path string, data []byte) (*Video, error) {
+	if len(data) < ivfFileHeaderSize || string(data[:4]) != "DKIF" {
+		return nil, errors.New("not an IVF file")
+	}
+
+	header := ivfreader.IVFFileHeader{
+		FourCC:              string(data[8:12]),
+		Width:               binary.LittleEndian.Uint16(data[12:]),
+		Height:              binary.LittleEndian.Uint16(data[14:]),
+		TimebaseDenominator: binary.LittleEndian.Uint32(data[16:]),
+		TimebaseNumerator:   binary.LittleEndian.Uint32(data[20:]),
+		NumFrames:           binary.LittleEndian.Uint32(data[24:]),
+	}
+	if header.TimebaseNumerator == 0 || header.TimebaseDenominator == 0 {
+		return nil, errors.New("zero IVF timebase")
+	}
+	offset := max(int(binary.LittleEndian.Uint16(data[6:])), ivfFileHeaderSize)
+
+	// The frame count of the header is not trusted; every frame takes at
+	// least its header.
+	capacity := min(int(header.NumFrames), (len(data)-offset)/ivfFrameHeaderSize)
+	video := &Video{
+		Path:   path,
+		Header: header,
+		data:   data,
+		frames: make([]Frame, 0, max(capacity, 0)),
+	}
+	for offset < len(data) {
+		if len(data)-offset < ivfFrameHeaderSize {
+			return nil, fmt.Errorf("parse frame %d: truncated header", len(video.frames))
+		}
+		size := int(binary.LittleEndian.Uint32(data[offset:]))
+		timestamp := binary.LittleEndian.Uint64(data[offset+4:])
+		offset += ivfFrameHeaderSize
+		if size > len(data)-offset {
+			return nil, fmt.Errorf("parse frame %d: truncated payload", len(video.frames))
+		}
+
+		video.frames = append(video.frames, Frame{
+			Offset:    offset,
+			Size:      size,
+			Timestamp: timestamp,
+			Keyframe:  isKeyframe(header.FourCC, data[offset:offset+size]),
+		})
+		video.size += size
+		offset += size
+	}
+
+	// Without increasing timestamps a frame lasts one timebase tick.
+	video.frameDuration = video.ticks(1)
+	if n := len(video.frames); n > 1 && video.frames[n-1].Timestamp > video.frames[0].Timestamp {
+		video.frameDuration = video.ticks(video.frames[n-1].Timestamp-video.frames[0].Timestamp) / time.Duration(n-1)
+	}
+
+	return video, nil
+}
+
+type entry struct {
+	once  sync.Once
+	video *Video
+	err   error
+}
+
+// Store is a process-wide cache of loaded videos keyed by path. It holds a
+// reference to the current version of every path. Publish and Remove
+// change the versions and bump the generation, which send loops poll to
+// pick up new versions.
+type Store struct {
+	mu      sync.Mutex
+	entries map[string]*entry
+
+	generation atomic.Uint64
+	onRelease  func(*Video)
+}
+
+func New() *Store {
+	return &Store{entries: make(map[string]*entry)}
+}
+
+// Get returns the video at path, loading it on first use. Concurrent callers
+// for the same path wait for a single load. A failed load is not kept, the
+// next Get tries again.
+func (s *Store) Get(path string) (*Video, error) {
+	s.mu.Lock()
+	e, ok := s.entries[path]
+	if !ok {
+		e = &entry{}
+		s.entries[path] = e
+	}
+	s.mu.Unlock()
+
+	s.load(e, path)
+	if e.err != nil {
+		s.mu.Lock()
+		if s.entries[path] == e {
+			delete(s.entries, path)
+		}
+		s.mu.Unlock()
+	}
+	return e.video, e.err
+}
+
+func (s *Store) load(e *entry, path string) {
+	e.once.Do(func() {
+		e.video, e.err = Load(path)
+		if e.video != nil {
+			e.video.store = s
+		}
+	})
+}
+
+// OnRelease sets a callback invoked when the last reference to a version of
+// the store is released, to free what was derived from it. It must be set
+// before the first Get.
+func (s *Store) OnRelease(f func(*Video)) {
+	s.onRelease = f
+}
+
+func (s *Store) released(video *Video) {
+	if s.onRelease != nil {
+		s.onRelease(video)
+	}
+}
+
+// Generation changes whenever a version is published or removed.
+func (s *Store) Generation() uint64 {
+	return s.generation.Load()
+}
+
+// Current returns the current version of path, nil if it is not loaded.
+// The caller must Acquire it before reading frames.
+func (s *Store) Current(path string) *Video {
+	s.mu.Lock()
+	e, ok := s.entries[path]
+	s.mu.Unlock()
+	if !ok {
+		return nil
+	}
+	s.load(e, path)
+	return e.video
+}
+
+// Changed reports whether the file at path differs from its current version
+// by size or modification time, or has none.
+func (s *Store) Changed(path string) (bool, error) {
+	info, err := os.Stat(path)
+	if err != nil {
+		return false, fmt.Errorf("stat file: %w", err)
+	}
+	current := s.Current(path)
+	return current == nil || current.fileSize != info.Size() || !current.modTime.Equal(info.ModTime()), nil
+}
+
+// Publish makes a video returned by Load the current version of its path,
+// taking over the reference of the caller. The previous version is
+// released by the store and freed once its last user releases it.
+func (s *Store) Publish(video *Video) {
+	video.store = s
+	e := &entry{video: video}
+	e.once.Do(func() {})
+
+	s.mu.Lock()
+	previous := s.entries[video.Path]
+	s.entries[video.Path] = e
+	s.mu.Unlock()
+	s.generation.Add(1)
+
+	if previous != nil && previous.video != nil {
+		previous.video.Release()
+	}
+}
+
+// Remove drops the current version of path, freed once its last user
+// releases it. Get loads the file anew afterwards.
+func (s *Store) Remove(path string) {
+	s.mu.Lock()
+	previous := s.entries[path]
+	delete(s.entries, path)
+	s.mu.Unlock()
+	s.generation.Add(1)
+
+	if previous != nil && previous.video != nil {
+		previous.video.Release()
+	}
+}
@@ -0,0 +1,145 @@
+package framestore
+
+import (
+	"bwe/demo/pkg/ivftest"
+	"bytes"
+	"os"
+	"path/filepath"
+	"testing"
+)
+
+// TestKeyframes checks that keyframes are found in the frames of every
+// codec.
+func TestKeyframes(t *testing.T) {
+	for _, fourCC := range []string{"VP80", "VP90", "AV01"} {
+		video, err := Load(ivftest.Temp(t, fourCC, 65, 100))
+		if err != nil {
+			t.Fatal(err)
+		}
+		for i := 0; i < video.FrameCount(); i++ {
+			if want := i%ivftest.KeyframeInterval == 0; video.FrameInfo(i).Keyframe != want {
+				t.Errorf("%s frame %d: keyframe %v, want %v", fourCC, i, !want, want)
+			}
+		}
+		if next := video.KeyframeAfter(1); next != ivftest.KeyframeInterval {
+			t.Errorf("%s: keyframe after 1 is %d", fourCC, next)
+		}
+	}
+
+	for _, frame := range [][]byte{nil, {0x12}, {6<<3 | 0x02, 0x80}} {
+		if isKeyframe("AV01", frame) {
+			t.Errorf("AV1 % x taken for a keyframe", frame)
+		}
+	}
+	if isKeyframe("H264", []byte{0}) {
+		t.Error("unknown codec taken for a keyframe")
+	}
+}
+
+// TestRewriteInPlace checks that a version still held keeps its frames when
+// the file is rewritten in place with a shorter one.
+func TestRewriteInPlace(t *testing.T) {
+	path := ivftest.Temp(t, "VP80", 60, 1000)
+	store := New()
+	video, err := store.Get(path)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if !video.Acquire() {
+		t.Fatal("acquire loaded video")
+	}
+	defer video.Release()
+	frames := make([][]byte, video.FrameCount())
+	for i := range frames {
+		frames[i] = bytes.Clone(video.Frame(i))
+	}
+
+	data, err := os.ReadFile(ivftest.Temp(t, "VP80", 10, 200))
+	if err != nil {
+		t.Fatal(err)
+	}
+	if err = os.WriteFile(path, data, 0o644); err != nil {
+		t.Fatal(err)
+	}
+
+	if changed, err := store.Changed(path); err != nil || !changed {
+		t.Fatalf("changed %v, %v after rewrite", changed, err)
+	}
+	reloaded, err := Load(path)
+	if err != nil {
+		t.Fatal(err)
+	}
+	store.Publish(reloaded)
+
+	if video.FrameCount() != len(frames) {
+		t.Fatalf("held version has %d frames, want %d", video.FrameCount(), len(frames))
+	}
+	for i, frame := range frames {
+		if !bytes.Equal(video.Frame(i), frame) {
+			t.Fatalf("frame %d of the held version changed", i)
+		}
+	}
+	if reloaded.FrameCount() != 10 {
+		t.Fatalf("reloaded version has %d frames, want 10", reloaded.FrameCount())
+	}
+}
+
+// TestGetRetriesFailedLoad checks that a failed load is not cached.
+func TestGetRetriesFailedLoad(t *testing.T) {
+	path := filepath.Join(t.TempDir(), "video.ivf")
+	store := New()
+	if _, err := store.Get(path); err == nil {
+		t.Fatal("got a missing file")
+	}
+
+	data, err := os.ReadFile(ivftest.Temp(t, "VP80", 10, 200))
+	if err != nil {
+		t.Fatal(err)
+	}
+	if err = os.WriteFile(path, data, 0o644); err != nil {
+		t.Fatal(err)
+	}
+	if _, err = store.Get(path); err != nil {
+		t.Fatalf("get after the file appeared: %v", err)
+	}
+}
+
+func BenchmarkLoad(b *testing.B) {
+	const frames, frameSize = 900, 4000
+	path := ivftest.Temp(b, "VP80", frames, frameSize)
+
+	b.SetBytes(frames * frameSize)
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		video, err := Load(path)
+		if err != nil {
+			b.Fatal(err)
+		}
+		_ = video.Close()
+	}
+	b.ReportMetric(float64(b.N*frames)/b.Elapsed().Seconds(), "frames/s")
+}
+
+// BenchmarkFrame covers what a send loop does per tick.
+func BenchmarkFrame(b *testing.B) {
+	video, err := Load(ivftest.Temp(b, "VP80", 900, 4000))
+	if err != nil {
+		b.Fatal(err)
+	}
+
+	var size int
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		j := i % video.FrameCount()
+		if video.FrameInfo(j).Keyframe {
+			size++
+		}
+		size += len(video.Frame(j))
+	}
+	b.ReportMetric(float64(b.N)/b.Elapsed().Seconds(), "frames/s")
+	if size == 0 {
+		b.Fatal("no frames")
+	}
+}
@@ -0,0 +1,93 @@
+package framestore
+
+// isKeyframe reports whether the frame can be decoded without references.
+// Unknown codecs report false so callers never switch on them.
+func isKeyframe(fourCC string, frame []byte) bool {
+	if len(frame) == 0 {
+		return false
+	}
+
+	switch fourCC {
+	case "VP80":
+		// RFC 6386 section 9.1: bit 0 of the frame tag is 0 for key frames.
+		return frame[0]&0x01 == 0
+	case "VP90":
+		return isVP9Keyframe(frame)
+	case "AV01":
+		return isAV1Keyframe(frame)
+	default:
+		return false
+	}
+}
+
+// isVP9Keyframe parses the start of the VP9 uncompressed header.
+func isVP9Keyframe(frame []byte) bool {
+	b := frame[0]
+	if b>>6 != 0x2 {
+		return false
+	}
+
+	profile := (b>>5)&0x1 | ((b>>4)&0x1)<<1
+	bit := 4
+	if profile == 3 {
+		bit++
+	}
+
+	showExistingFrame := (b >> (7 - bit)) & 0x1
+	if showExistingFrame == 1 {
+		return false
+	}
+	bit++
+
+	frameType := (b >> (7 - bit)) & 0x1
+	return frameType == 0
+}
+
+// isAV1Keyframe treats a temporal unit carrying a sequence header OBU as a
+// keyframe, which is how encoders emit random access points.
+func isAV1Keyframe(frame []byte) bool {
+	const obuSequenceHeader = 1
+
+	for len(frame) > 0 {
+		header := frame[0]
+		obuType := (header >> 3) & 0xf
+		hasExtension := (header>>2)&0x1 == 1
+		hasSize := (header>>1)&0x1 == 1
+		if obuType == obuSequenceHeader {
+			return true
+		}
+		if !hasSize {
+			return false
+		}
+
+		offset := 1
+		if hasExtension {
+			offset++
+		}
+
+		size, n := leb128(frame[min(offset, len(frame)):])
+		if n == 0 {
+			return false
+		}
+		offset += n
+
+		if uint64(len(frame)-offset) < size {
+			return false
+		}
+		frame = frame[offset+int(size):]
+	}
+
+	return false
+}
+
+func leb128(data []byte) (uint64, int) {
+	var value uint64
+	for i := 0; i < len(data) && i < 8; i++ {
+		value |= uint64(data[i]&0x7f) << (7 * i)
+		if data[i]&0x80 == 0 {
+			return value, i + 1
+		}
+	}
+
+	return 0, 0
+}
@@ -0,0 +1,96 @@
+// Package ivftest writes synthetic IVF files for tests and benchmarks.
+package ivftest
+
+import (
+	"encoding/binary"
+	"os"
+	"path/filepath"
+	"testing"
+)
+
+// KeyframeInterval is the distance between the keyframes of the files.
+const KeyframeInterval = 30
+
+// Data returns a 640x360, 30 fps file of frames frames with a keyframe
+// every KeyframeInterval, starting with one. Frames are frameSize bytes,
+// AV1 ones a little more, and start the way the codec marks keyframes and
+// interframes, so the frame store indexes them and the pion payloaders
+// accept them.
+func Data(fourCC string, frames, frameSize int) []byte {
+	data := make([]byte, 0, 32+frames*(12+frameSize+16))
+	data = append(data, "DKIF"...)
+	data = binary.LittleEndian.AppendUint16(data, 0)
+	data = binary.LittleEndian.AppendUint16(data, 32)
+	data = append(data, fourCC...)
+	data = binary.LittleEndian.AppendUint16(data, 640)
+	data = binary.LittleEndian.AppendUint16(data, 360)
+	data = binary.LittleEndian.AppendUint32(data, 30)
+	data = binary.LittleEndian.AppendUint32(data, 1)
+	data = binary.LittleEndian.AppendUint32(data, uint32(frames))
+	data = binary.LittleEndian.AppendUint32(data, 0)
+
+	for i := 0; i < frames; i++ {
+		frame := Frame(fourCC, frameSize, i%KeyframeInterval == 0)
+		data = binary.LittleEndian.AppendUint32(data, uint32(len(frame)))
+		data = binary.LittleEndian.AppendUint64(data, uint64(i))
+		data = append(data, frame...)
+	}
+	return data
+}
+
+// Frame returns a frame of the codec of about size bytes.
+func Frame(fourCC string, size int, keyframe bool) []byte {
+	switch fourCC {
+	case "VP90":
+		// Frame marker, profile 0, and frame_type 0 for keyframes.
+		frame := make([]byte, size)
+		frame[0] = 0x84
+		if keyframe {
+			frame[0] = 0x80
+		}
+		return frame
+	case "AV01":
+		// Keyframes start with a sequence header OBU; the payload is one
+		// OBU_FRAME with a size field.
+		var frame []byte
+		if keyframe {
+			frame = append(frame, 1<<3|0x02, 1, 0)
+		}
+		return appendOBU(frame, 6, size)
+	default:
+		// VP8 marks interframes with the lowest bit of the frame tag.
+		frame := make([]byte, size)
+		if !keyframe {
+			frame[0] = 1
+		}
+		return frame
+	}
+}
+
+func appendOBU(b []byte, obuType byte, size int) []byte {
+	b = append(b, obuType<<3|0x02)
+	for n := size; ; n >>= 7 {
+		if n < 0x80 {
+			b = append(b, byte(n))
+			break
+		}
+		b = append(b, byte(n)|0x80)
+	}
+	return append(b, make([]byte, size)...)
+}
+
+// Write writes Data to path.
+func Write(tb testing.TB, path, fourCC string, frames, frameSize int) {
+	tb.Helper()
+	if err := os.WriteFile(path, Data(fourCC, frames, frameSize), 0o644); err != nil {
+		tb.Fatal(err)
+	}
+}
+
+// Temp writes Data into a temporary directory of tb and returns its path.
+func Temp(tb testing.TB, fourCC string, frames, frameSize int) string {
+	tb.Helper()
+	path := filepath.Join(tb.TempDir(), "video.ivf")
+	Write(tb, path, fourCC, frames, frameSize)
+	return path
+}
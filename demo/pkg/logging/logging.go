@@ -0,0 +1,266 @@
+// Package logging is a slog backend for the send paths. Records are queued
+// without blocking and formatted and written by a dedicated goroutine, and
+// records repeating the same message are rate limited, so that many
+// sessions failing together cost a counter increment each instead of a
+// write to stderr.
+package logging
+
+import (
+	"bufio"
+	"context"
+	"fmt"
+	"io"
+	"log/slog"
+	"sync"
+	"sync/atomic"
+	"time"
+)
+
+type Config struct {
+	// Format is text or json.
+	Format string     `yaml:"format"`
+	Level  slog.Level `yaml:"level"`
+	// BufferSize records wait for the writer, newer ones are dropped and
+	// counted.
+	BufferSize int `yaml:"buffer_size"`
+	// Burst records of a level and message are written per Interval, the
+	// rest are counted and the count is added to the next one written. The
+	// limit is global, not per session: records differing only in their
+	// attributes, such as the session ID, share it, so a failure hitting
+	// many sessions at once is written Burst times in all. A zero Burst
+	// disables the limit.
+	Burst    int           `yaml:"burst"`
+	Interval time.Duration `yaml:"interval"`
+}
+
+func (c Config) WithDefaults() Config {
+	if c.Format == "" {
+		c.Format = "text"
+	}
+	if c.BufferSize <= 0 {
+		c.BufferSize = 4096
+	}
+	if c.Interval <= 0 {
+		c.Interval = time.Second
+	}
+	return c
+}
+
+// Handler is the slog handler. Handlers derived with WithAttrs and
+// WithGroup share its queue, writer and limits.
+type Handler struct {
+	inner  slog.Handler
+	shared *shared
+}
+
+type shared struct {
+	config  Config
+	out     *bufio.Writer
+	records chan entry
+	done    chan struct{}
+	closed  atomic.Bool
+
+	limitMu sync.Mutex
+	limits  map[limitKey]*limit
+	// swept is when limits past their interval were last evicted.
+	swept time.Time
+
+	dropped    atomic.Uint64
+	suppressed atomic.Uint64
+
+	closeOnce sync.Once
+	wg        sync.WaitGroup
+}
+
+// entry is a queued record with the handler, and so the attributes and
+// groups, it was logged through.
+type entry struct {
+	inner  slog.Handler
+	record slog.Record
+}
+
+type limitKey struct {
+	level   slog.Level
+	message string
+}
+
+type limit struct {
+	start      time.Time
+	count      int
+	suppressed int
+}
+
+// New returns a handler writing to w. Its writer goroutine runs until
+// Close.
+func New(w io.Writer, config Config) (*Handler, error) {
+	config = config.WithDefaults()
+	s := &shared{
+		config:  config,
+		out:     bufio.NewWriter(w),
+		records: make(chan entry, config.BufferSize),
+		done:    make(chan struct{}),
+		limits:  map[limitKey]*limit{},
+	}
+
+	options := &slog.HandlerOptions{Level: config.Level}
+	var inner slog.Handler
+	switch config.Format {
+	case "text":
+		inner = slog.NewTextHandler(s.out, options)
+	case "json":
+		inner = slog.NewJSONHandler(s.out, options)
+	default:
+		return nil, fmt.Errorf("unknown log format %s", config.Format)
+	}
+
+	s.wg.Add(1)
+	go s.run()
+
+	return &Handler{inner: inner, shared: s}, nil
+}
+
+func (h *Handler) Enabled(ctx context.Context, level slog.Level) bool {
+	return h.inner.Enabled(ctx, level)
+}
+
+// Handle queues the record unless it is over its limit. It never blocks and
+// never fails: records that do not fit into the queue or arrive after Close
+// are dropped and counted.
+func (h *Handler) Handle(_ context.Context, record slog.Record) error {
+	s := h.shared
+	if s.closed.Load() {
+		s.dropped.Add(1)
+		return nil
+	}
+
+	suppressed, ok := s.allow(record)
+	if !ok {
+		s.suppressed.Add(1)
+		return nil
+	}
+
+	// The record's attributes may be reused by the caller once Handle
+	// returns.
+	record = record.Clone()
+	if suppressed > 0 {
+		record.AddAttrs(slog.Int("suppressed", suppressed))
+	}
+
+	select {
+	case s.records <- entry{inner: h.inner, record: record}:
+	default:
+		s.dropped.Add(1)
+	}
+	return nil
+}
+
+func (h *Handler) WithAttrs(attrs []slog.Attr) slog.Handler {
+	return &Handler{inner: h.inner.WithAttrs(attrs), shared: h.shared}
+}
+
+func (h *Handler) WithGroup(name string) slog.Handler {
+	return &Handler{inner: h.inner.WithGroup(name), shared: h.shared}
+}
+
+// Dropped returns the number of records dropped on a full queue or after
+// Close.
+func (h *Handler) Dropped() uint64 {
+	return h.shared.dropped.Load()
+}
+
+// Suppressed returns the number of records over their rate limit.
+func (h *Handler) Suppressed() uint64 {
+	return h.shared.suppressed.Load()
+}
+
+// Close writes the queued records and stops the writer. Records logged
+// afterwards are dropped.
+func (h *Handler) Close() error {
+	s := h.shared
+	var err error
+	s.closeOnce.Do(func() {
+		s.closed.Store(true)
+		close(s.done)
+		s.wg.Wait()
+		err = s.out.Flush()
+	})
+	return err
+}
+
+// allow reports whether the record is within the limit of its level and
+// message, and how many records of the key were suppressed since the last
+// one allowed.
+func (s *shared) allow(record slog.Record) (int, bool) {
+	if s.config.Burst <= 0 {
+		return 0, true
+	}
+
+	key := limitKey{level: record.Level, message: record.Message}
+	s.limitMu.Lock()
+	defer s.limitMu.Unlock()
+	s.sweep(record.Time)
+
+	l, ok := s.limits[key]
+	if !ok {
+		l = &limit{start: record.Time}
+		s.limits[key] = l
+	}
+	if record.Time.Sub(l.start) >= s.config.Interval {
+		l.start = record.Time
+		l.count = 0
+	}
+	if l.count >= s.config.Burst {
+		l.suppressed++
+		return 0, false
+	}
+	l.count++
+	suppressed := l.suppressed
+	l.suppressed = 0
+	return suppressed, true
+}
+
+// sweep evicts the limits whose interval ended, at most once per interval,
+// so messages that are not repeated, such as ones carrying an ID, do not
+// keep their limits forever. A later record of an evicted key starts a new
+// interval, as it would have anyway; only the count of records suppressed
+// in the last interval is not added to it, they stay in Suppressed.
+func (s *shared) sweep(now time.Time) {
+	if now.Sub(s.swept) < s.config.Interval {
+		return
+	}
+	s.swept = now
+	for key, l := range s.limits {
+		if now.Sub(l.start) >= s.config.Interval {
+			delete(s.limits, key)
+		}
+	}
+}
+
+// run writes queued records, flushing whenever the queue runs empty, until
+// done, and then writes what is left.
+func (s *shared) run() {
+	defer s.wg.Done()
+	for {
+		select {
+		case e := <-s.records:
+			s.write(e)
+		case <-s.done:
+			for {
+				select {
+				case e := <-s.records:
+					s.write(e)
+				default:
+					return
+				}
+			}
+		}
+
+		if len(s.records) == 0 {
+			_ = s.out.Flush()
+		}
+	}
+}
+
+func (s *shared) write(e entry) {
+	_ = e.inner.Handle(context.Background(), e.record)
+}
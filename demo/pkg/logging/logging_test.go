@@ -0,0 +1,41 @@
+package logging
+
+import (
+	"fmt"
+	"io"
+	"log/slog"
+	"testing"
+	"time"
+)
+
+// TestAllowEvicts checks that records over Burst are suppressed within an
+// interval and that the limits of messages not repeated are evicted once
+// their interval ended.
+func TestAllowEvicts(t *testing.T) {
+	h, err := New(io.Discard, Config{Burst: 2, Interval: time.Second})
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer h.Close()
+	s := h.shared
+
+	start := time.Now()
+	for i := 0; i < 3; i++ {
+		_, ok := s.allow(slog.NewRecord(start, slog.LevelError, "send failed", 0))
+		if ok != (i < 2) {
+			t.Fatalf("record %d allowed %v", i, ok)
+		}
+	}
+	for i := 0; i < 100; i++ {
+		s.allow(slog.NewRecord(start, slog.LevelError, fmt.Sprintf("session %d failed", i), 0))
+	}
+
+	next := start.Add(time.Second)
+	suppressed, ok := s.allow(slog.NewRecord(next, slog.LevelInfo, "tick", 0))
+	if !ok || suppressed != 0 {
+		t.Fatalf("new message suppressed %d, allowed %v", suppressed, ok)
+	}
+	if len(s.limits) != 1 {
+		t.Fatalf("%d limits kept after their interval, want 1", len(s.limits))
+	}
+}
@@ -0,0 +1,149 @@
+package metrics
+
+import (
+	"bufio"
+	"sync"
+)
+
+type counter struct {
+	desc
+	*Counter
+}
+
+func (c counter) write(w *bufio.Writer) {
+	c.writeHeader(w)
+	writeSample(w, c.name, "", float64(c.Value()))
+}
+
+func (r *Registry) NewCounter(name, help string) *Counter {
+	c := counter{desc{name, help, "counter"}, &Counter{}}
+	r.register(c)
+	return c.Counter
+}
+
+type gauge struct {
+	desc
+	*Gauge
+}
+
+func (g gauge) write(w *bufio.Writer) {
+	g.writeHeader(w)
+	writeSample(w, g.name, "", float64(g.Value()))
+}
+
+func (r *Registry) NewGauge(name, help string) *Gauge {
+	g := gauge{desc{name, help, "gauge"}, &Gauge{}}
+	r.register(g)
+	return g.Gauge
+}
+
+type gaugeFunc struct {
+	desc
+	value func() float64
+}
+
+func (g gaugeFunc) write(w *bufio.Writer) {
+	g.writeHeader(w)
+	writeSample(w, g.name, "", g.value())
+}
+
+// NewGaugeFunc registers a gauge computed on scrape.
+func (r *Registry) NewGaugeFunc(name, help string, value func() float64) {
+	r.register(gaugeFunc{desc{name, help, "gauge"}, value})
+}
+
+type histogram struct {
+	desc
+	*Histogram
+}
+
+func (h histogram) write(w *bufio.Writer) {
+	h.writeHeader(w)
+	h.Histogram.write(w, h.name, "")
+}
+
+func (r *Registry) NewHistogram(name, help string, bounds []float64) *Histogram {
+	h := histogram{desc{name, help, "histogram"}, newHistogram(bounds)}
+	r.register(h)
+	return h.Histogram
+}
+
+// vec keeps one child per label value. Callers should look children up once
+// and keep them, With takes a lock.
+type vec[T any] struct {
+	desc
+	label    string
+	newChild func() *T
+
+	mu       sync.Mutex
+	values   []string
+	children map[string]*T
+}
+
+func (v *vec[T]) With(value string) *T {
+	v.mu.Lock()
+	defer v.mu.Unlock()
+
+	child, ok := v.children[value]
+	if !ok {
+		child = v.newChild()
+		v.children[value] = child
+		v.values = append(v.values, value)
+	}
+	return child
+}
+
+func (v *vec[T]) each(f func(labels string, child *T)) {
+	v.mu.Lock()
+	defer v.mu.Unlock()
+
+	for _, value := range v.values {
+		f(formatLabel(v.label, value), v.children[value])
+	}
+}
+
+// CounterVec is a counter partitioned by one label.
+type CounterVec struct {
+	*vec[Counter]
+}
+
+func (c CounterVec) write(w *bufio.Writer) {
+	c.writeHeader(w)
+	c.each(func(labels string, child *Counter) {
+		writeSample(w, c.name, wrapLabels(labels), float64(child.Value()))
+	})
+}
+
+func (r *Registry) NewCounterVec(name, help, label string) CounterVec {
+	c := CounterVec{&vec[Counter]{
+		desc:     desc{name, help, "counter"},
+		label:    label,
+		newChild: func() *Counter { return &Counter{} },
+		children: map[string]*Counter{},
+	}}
+	r.register(c)
+	return c
+}
+
+// HistogramVec is a histogram partitioned by one label.
+type HistogramVec struct {
+	*vec[Histogram]
+}
+
+func (h HistogramVec) write(w *bufio.Writer) {
+	h.writeHeader(w)
+	h.each(func(labels string, child *Histogram) {
+		child.write(w, h.name, labels)
+	})
+}
+
+func (r *Registry) NewHistogramVec(name, help, label string, bounds []float64) HistogramVec {
+	h := HistogramVec{&vec[Histogram]{
+		desc:     desc{name, help, "histogram"},
+		label:    label,
+		newChild: func() *Histogram { return newHistogram(bounds) },
+		children: map[string]*Histogram{},
+	}}
+	r.register(h)
+	return h
+}
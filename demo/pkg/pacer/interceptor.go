@@ -0,0 +1,50 @@
+package pacer
+
+import (
+	"github.com/pion/interceptor"
+)
+
+// NewPeerConnectionCallback receives the pacer created for a peer connection.
+type NewPeerConnectionCallback func(id string, pacer *Pacer)
+
+// InterceptorFactory paces local streams at a fixed bitrate. It is used when
+// no bandwidth estimator drives the pacer.
+type InterceptorFactory struct {
+	config              Config
+	onNewPeerConnection NewPeerConnectionCallback
+}
+
+func NewInterceptor(config Config) *InterceptorFactory {
+	return &InterceptorFactory{config: config}
+}
+
+// OnNewPeerConnection sets the callback invoked for every new pacer.
+func (f *InterceptorFactory) OnNewPeerConnection(cb NewPeerConnectionCallback) {
+	f.onNewPeerConnection = cb
+}
+
+func (f *InterceptorFactory) NewInterceptor(id string) (interceptor.Interceptor, error) {
+	i := &Interceptor{pacer: New(f.config)}
+	if f.onNewPeerConnection != nil {
+		f.onNewPeerConnection(id, i.pacer)
+	}
+	return i, nil
+}
+
+type Interceptor struct {
+	interceptor.NoOp
+	pacer *Pacer
+}
+
+func (i *Interceptor) BindLocalStream(info *interceptor.StreamInfo, writer interceptor.RTPWriter) interceptor.RTPWriter {
+	i.pacer.AddStream(info.SSRC, writer)
+	return i.pacer
+}
+
+func (i *Interceptor) UnbindLocalStream(info *interceptor.StreamInfo) {
+	i.pacer.RemoveStream(info.SSRC)
+}
+
+func (i *Interceptor) Close() error {
+	return i.pacer.Close()
+}
@@ -0,0 +1,277 @@
+// Package pacer spreads RTP packets over time so that large frames do not
+// leave as a burst of back-to-back packets.
+package pacer
+
+import (
+	"sync"
+	"time"
+
+	"github.com/pion/interceptor"
+	"github.com/pion/rtp"
+)
+
+type Config struct {
+	// InitialBitrate is the target bitrate until SetTargetBitrate is called.
+	InitialBitrate int `yaml:"initial_bitrate"`
+	// Factor scales the target bitrate to get the pacing rate, so that the
+	// pacer can drain a queue built up behind a keyframe.
+	Factor float64 `yaml:"factor"`
+	// Burst is the number of bytes that may be sent back to back.
+	Burst int `yaml:"burst"`
+	// Interval is how often the queue is drained.
+	Interval time.Duration `yaml:"interval"`
+	// MaxQueue is the number of queued packets after which new ones are dropped.
+	MaxQueue int `yaml:"max_queue"`
+}
+
+func (c Config) withDefaults() Config {
+	if c.InitialBitrate <= 0 {
+		c.InitialBitrate = 1_000_000
+	}
+	if c.Factor <= 0 {
+		c.Factor = 1.5
+	}
+	if c.Burst <= 0 {
+		c.Burst = 10 * 1200
+	}
+	if c.Interval <= 0 {
+		c.Interval = 5 * time.Millisecond
+	}
+	if c.MaxQueue <= 0 {
+		c.MaxQueue = 1000
+	}
+	return c
+}
+
+type attributesKey int
+
+// ProbeAttributesKey marks a packet of a bandwidth probe cluster in the
+// write attributes. The prober paces clusters itself, so probes spend no
+// budget. They still wait behind queued media, so that packets leave in
+// sequence number order.
+const ProbeAttributesKey attributesKey = 0
+
+// Stats describes the pacer queue since it was created.
+type Stats struct {
+	Sent          uint64
+	Dropped       uint64
+	Probes        uint64
+	Queued        int
+	QueueDelayAvg time.Duration
+	QueueDelayMax time.Duration
+}
+
+type item struct {
+	header     rtp.Header
+	payload    *[]byte
+	size       int
+	attributes interceptor.Attributes
+	enqueued   time.Time
+	writer     interceptor.RTPWriter
+	probe      bool
+}
+
+// Pacer is a leaky bucket in front of the RTP writers of one session. It
+// satisfies gcc.Pacer, so the bandwidth estimator can drive its rate.
+type Pacer struct {
+	config Config
+
+	mu         sync.Mutex
+	rate       float64 // bytes per second
+	budget     float64
+	lastRefill time.Time
+	queue      []item
+	writers    map[uint32]interceptor.RTPWriter
+
+	sent            uint64
+	dropped         uint64
+	probes          uint64
+	queueDelaySum   time.Duration
+	queueDelayMax   time.Duration
+	queueDelayCount uint64
+
+	pool      sync.Pool
+	done      chan struct{}
+	closeOnce sync.Once
+	wg        sync.WaitGroup
+}
+
+func New(config Config) *Pacer {
+	config = config.withDefaults()
+	p := &Pacer{
+		config:     config,
+		budget:     float64(config.Burst),
+		lastRefill: time.Now(),
+		writers:    make(map[uint32]interceptor.RTPWriter),
+		pool: sync.Pool{New: func() any {
+			buf := make([]byte, 1500)
+			return &buf
+		}},
+		done: make(chan struct{}),
+	}
+	p.setRate(config.InitialBitrate)
+
+	p.wg.Add(1)
+	go p.run()
+
+	return p
+}
+
+// AddStream registers the writer packets with the given SSRC are sent to.
+func (p *Pacer) AddStream(ssrc uint32, writer interceptor.RTPWriter) {
+	p.mu.Lock()
+	defer p.mu.Unlock()
+	p.writers[ssrc] = writer
+}
+
+// RemoveStream stops sending packets with the given SSRC.
+func (p *Pacer) RemoveStream(ssrc uint32) {
+	p.mu.Lock()
+	defer p.mu.Unlock()
+	delete(p.writers, ssrc)
+}
+
+// SetTargetBitrate updates the bitrate in bits per second the pacer follows.
+func (p *Pacer) SetTargetBitrate(bitrate int) {
+	p.mu.Lock()
+	defer p.mu.Unlock()
+	p.setRate(bitrate)
+}
+
+func (p *Pacer) setRate(bitrate int) {
+	p.rate = float64(bitrate) * p.config.Factor / 8
+}
+
+// Write queues the packet. It is sent right away when the queue is empty
+// and the burst budget allows it; a probe only needs the queue empty.
+func (p *Pacer) Write(header *rtp.Header, payload []byte, attributes interceptor.Attributes) (int, error) {
+	size := header.MarshalSize() + len(payload)
+	probe := attributes.Get(ProbeAttributesKey) != nil
+
+	p.mu.Lock()
+	if probe {
+		p.probes++
+	}
+
+	p.refill(time.Now())
+	if len(p.queue) == 0 && (probe || p.budget >= float64(size)) {
+		writer, ok := p.writers[header.SSRC]
+		if !probe {
+			p.budget -= float64(size)
+			p.sent++
+		}
+		p.mu.Unlock()
+
+		if !ok {
+			return size, nil
+		}
+		return writer.Write(header, payload, attributes)
+	}
+	defer p.mu.Unlock()
+
+	if len(p.queue) >= p.config.MaxQueue {
+		p.dropped++
+		return size, nil
+	}
+
+	buf := p.pool.Get().(*[]byte)
+	if cap(*buf) < len(payload) {
+		*buf = make([]byte, len(payload))
+	}
+	*buf = (*buf)[:len(payload)]
+	copy(*buf, payload)
+
+	p.queue = append(p.queue, item{
+		header:     header.Clone(),
+		payload:    buf,
+		size:       size,
+		attributes: attributes,
+		enqueued:   time.Now(),
+		probe:      probe,
+	})
+
+	return size, nil
+}
+
+// refill adds the budget accumulated since the last call, capped at one
+// burst so that an idle pacer does not release an unbounded burst.
+func (p *Pacer) refill(now time.Time) {
+	p.budget += p.rate * now.Sub(p.lastRefill).Seconds()
+	p.budget = min(p.budget, float64(p.config.Burst))
+	p.lastRefill = now
+}
+
+func (p *Pacer) run() {
+	defer p.wg.Done()
+
+	ticker := time.NewTicker(p.config.Interval)
+	defer ticker.Stop()
+	for {
+		select {
+		case <-p.done:
+			return
+		case now := <-ticker.C:
+			p.drain(now)
+		}
+	}
+}
+
+func (p *Pacer) drain(now time.Time) {
+	p.mu.Lock()
+	p.refill(now)
+
+	var ready []item
+	for len(p.queue) > 0 && (p.budget > 0 || p.queue[0].probe) {
+		it := p.queue[0]
+		p.queue[0] = item{}
+		p.queue = p.queue[1:]
+		it.writer = p.writers[it.header.SSRC]
+		ready = append(ready, it)
+		if it.probe {
+			continue
+		}
+		p.budget -= float64(it.size)
+
+		delay := now.Sub(it.enqueued)
+		p.queueDelaySum += delay
+		p.queueDelayCount++
+		p.queueDelayMax = max(p.queueDelayMax, delay)
+		p.sent++
+	}
+	p.mu.Unlock()
+
+	for i := range ready {
+		it := &ready[i]
+		if it.writer != nil {
+			_, _ = it.writer.Write(&it.header, *it.payload, it.attributes)
+		}
+		p.pool.Put(it.payload)
+	}
+}
+
+// Stats returns a snapshot of queue statistics.
+func (p *Pacer) Stats() Stats {
+	p.mu.Lock()
+	defer p.mu.Unlock()
+
+	stats := Stats{
+		Sent:          p.sent,
+		Dropped:       p.dropped,
+		Probes:        p.probes,
+		Queued:        len(p.queue),
+		QueueDelayMax: p.queueDelayMax,
+	}
+	if p.queueDelayCount > 0 {
+		stats.QueueDelayAvg = p.queueDelaySum / time.Duration(p.queueDelayCount)
+	}
+	return stats
+}
+
+// Close stops the pacer and drops queued packets.
+func (p *Pacer) Close() error {
+	p.closeOnce.Do(func() {
+		close(p.done)
+		p.wg.Wait()
+	})
+	return nil
+}
@@ -0,0 +1,63 @@
+package pacer
+
+import (
+	"sync"
+	"testing"
+	"time"
+
+	"github.com/pion/interceptor"
+	"github.com/pion/rtp"
+)
+
+// TestProbeBehindQueuedMedia checks that a probe written while media waits
+// in the queue leaves after it, in sequence number order.
+func TestProbeBehindQueuedMedia(t *testing.T) {
+	p := New(Config{InitialBitrate: 800_000, Burst: 1500, Interval: time.Millisecond})
+	defer p.Close()
+
+	var mu sync.Mutex
+	var sent []uint16
+	p.AddStream(1, interceptor.RTPWriterFunc(func(header *rtp.Header, payload []byte, _ interceptor.Attributes) (int, error) {
+		mu.Lock()
+		sent = append(sent, header.SequenceNumber)
+		mu.Unlock()
+		return len(payload), nil
+	}))
+
+	payload := make([]byte, 1000)
+	for seq := uint16(1); seq <= 4; seq++ {
+		if _, err := p.Write(&rtp.Header{SSRC: 1, SequenceNumber: seq}, payload, interceptor.Attributes{}); err != nil {
+			t.Fatal(err)
+		}
+	}
+	probe := interceptor.Attributes{}
+	probe.Set(ProbeAttributesKey, 1)
+	if _, err := p.Write(&rtp.Header{SSRC: 1, SequenceNumber: 5, Padding: true}, make([]byte, 255), probe); err != nil {
+		t.Fatal(err)
+	}
+
+	deadline := time.Now().Add(time.Second)
+	for {
+		mu.Lock()
+		n := len(sent)
+		mu.Unlock()
+		if n == 5 {
+			break
+		}
+		if time.Now().After(deadline) {
+			t.Fatalf("sent %d of 5 packets", n)
+		}
+		time.Sleep(time.Millisecond)
+	}
+
+	mu.Lock()
+	defer mu.Unlock()
+	for i, seq := range sent {
+		if seq != uint16(i+1) {
+			t.Fatalf("sent %v, want sequence number order", sent)
+		}
+	}
+	if stats := p.Stats(); stats.Sent != 4 || stats.Probes != 1 {
+		t.Fatalf("stats %+v, want 4 sent and 1 probe", stats)
+	}
+}
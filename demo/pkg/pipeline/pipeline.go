@@ -0,0 +1,183 @@
+// Package pipeline registers the interceptors webrtc.RegisterDefaultInterceptors
+// adds, with buffer sizes and intervals taken from the config, so runs can
+// compare loss recovery and feedback rates across pipelines.
+package pipeline
+
+import (
+	"fmt"
+	"strings"
+	"time"
+
+	"github.com/pion/interceptor"
+	"github.com/pion/interceptor/pkg/nack"
+	"github.com/pion/interceptor/pkg/report"
+	"github.com/pion/interceptor/pkg/twcc"
+	"github.com/pion/sdp/v3"
+	"github.com/pion/webrtc/v4"
+)
+
+// Config selects the default interceptors. The zero value is pion's
+// default pipeline.
+type Config struct {
+	// Name identifies the pipeline in reports.
+	Name    string        `yaml:"name"`
+	NACK    NACKConfig    `yaml:"nack"`
+	Reports ReportsConfig `yaml:"reports"`
+	TWCC    TWCCConfig    `yaml:"twcc"`
+}
+
+// NACKConfig sizes the packet history the responder retransmits from and
+// the window the generator tracks losses in. Sizes must be powers of two up
+// to 32768; zero values keep the pion defaults.
+type NACKConfig struct {
+	Disabled           bool          `yaml:"disabled"`
+	ResponderSize      uint16        `yaml:"responder_size"`
+	GeneratorSize      uint16        `yaml:"generator_size"`
+	GeneratorSkipLastN uint16        `yaml:"generator_skip_last_n"`
+	GeneratorInterval  time.Duration `yaml:"generator_interval"`
+}
+
+// ReportsConfig sets how often sender and receiver reports are sent.
+type ReportsConfig struct {
+	Disabled bool          `yaml:"disabled"`
+	Interval time.Duration `yaml:"interval"`
+}
+
+// TWCCConfig sets how often a receiver sends transport-wide feedback, which
+// drives the send-side estimate.
+type TWCCConfig struct {
+	Disabled bool          `yaml:"disabled"`
+	Interval time.Duration `yaml:"interval"`
+}
+
+// Register adds the configured interceptors to ir in the order
+// webrtc.RegisterDefaultInterceptors uses and negotiates their feedback.
+func Register(m *webrtc.MediaEngine, ir *interceptor.Registry, config Config) error {
+	if !config.NACK.Disabled {
+		err := registerNACK(m, ir, config.NACK)
+		if err != nil {
+			return err
+		}
+	}
+
+	if !config.Reports.Disabled {
+		err := registerReports(ir, config.Reports)
+		if err != nil {
+			return err
+		}
+	}
+
+	err := webrtc.ConfigureSimulcastExtensionHeaders(m)
+	if err != nil {
+		return fmt.Errorf("configure simulcast extension headers: %w", err)
+	}
+
+	if !config.TWCC.Disabled {
+		err = registerTWCC(m, ir, config.TWCC)
+		if err != nil {
+			return err
+		}
+	}
+
+	return nil
+}
+
+func registerNACK(m *webrtc.MediaEngine, ir *interceptor.Registry, config NACKConfig) error {
+	var responderOptions []nack.ResponderOption
+	if config.ResponderSize > 0 {
+		responderOptions = append(responderOptions, nack.ResponderSize(config.ResponderSize))
+	}
+	responder, err := nack.NewResponderInterceptor(responderOptions...)
+	if err != nil {
+		return fmt.Errorf("new nack responder: %w", err)
+	}
+
+	var generatorOptions []nack.GeneratorOption
+	if config.GeneratorSize > 0 {
+		generatorOptions = append(generatorOptions, nack.GeneratorSize(config.GeneratorSize))
+	}
+	if config.GeneratorSkipLastN > 0 {
+		generatorOptions = append(generatorOptions, nack.GeneratorSkipLastN(config.GeneratorSkipLastN))
+	}
+	if config.GeneratorInterval > 0 {
+		generatorOptions = append(generatorOptions, nack.GeneratorInterval(config.GeneratorInterval))
+	}
+	generator, err := nack.NewGeneratorInterceptor(generatorOptions...)
+	if err != nil {
+		return fmt.Errorf("new nack generator: %w", err)
+	}
+
+	m.RegisterFeedback(webrtc.RTCPFeedback{Type: webrtc.TypeRTCPFBNACK}, webrtc.RTPCodecTypeVideo)
+	m.RegisterFeedback(webrtc.RTCPFeedback{Type: webrtc.TypeRTCPFBNACK, Parameter: "pli"}, webrtc.RTPCodecTypeVideo)
+	ir.Add(responder)
+	ir.Add(generator)
+	return nil
+}
+
+func registerReports(ir *interceptor.Registry, config ReportsConfig) error {
+	var receiverOptions []report.ReceiverOption
+	var senderOptions []report.SenderOption
+	if config.Interval > 0 {
+		receiverOptions = append(receiverOptions, report.ReceiverInterval(config.Interval))
+		senderOptions = append(senderOptions, report.SenderInterval(config.Interval))
+	}
+
+	receiver, err := report.NewReceiverInterceptor(receiverOptions...)
+	if err != nil {
+		return fmt.Errorf("new receiver report interceptor: %w", err)
+	}
+	sender, err := report.NewSenderInterceptor(senderOptions...)
+	if err != nil {
+		return fmt.Errorf("new sender report interceptor: %w", err)
+	}
+
+	ir.Add(receiver)
+	ir.Add(sender)
+	return nil
+}
+
+func registerTWCC(m *webrtc.MediaEngine, ir *interceptor.Registry, config TWCCConfig) error {
+	m.RegisterFeedback(webrtc.RTCPFeedback{Type: webrtc.TypeRTCPFBTransportCC}, webrtc.RTPCodecTypeVideo)
+	err := m.RegisterHeaderExtension(webrtc.RTPHeaderExtensionCapability{URI: sdp.TransportCCURI}, webrtc.RTPCodecTypeVideo)
+	if err != nil {
+		return fmt.Errorf("register twcc header extension: %w", err)
+	}
+
+	var options []twcc.Option
+	if config.Interval > 0 {
+		options = append(options, twcc.SendInterval(config.Interval))
+	}
+	generator, err := twcc.NewSenderInterceptor(options...)
+	if err != nil {
+		return fmt.Errorf("new twcc sender: %w", err)
+	}
+
+	ir.Add(generator)
+	return nil
+}
+
+// String lists the enabled interceptors with their settings, zero values
+// being pion defaults.
+func (c Config) String() string {
+	var parts []string
+	if !c.NACK.Disabled {
+		parts = append(parts, fmt.Sprintf("nack(responder_size=%d generator_size=%d skip_last_n=%d interval=%s)",
+			c.NACK.ResponderSize, c.NACK.GeneratorSize, c.NACK.GeneratorSkipLastN, c.NACK.GeneratorInterval))
+	}
+	if !c.Reports.Disabled {
+		parts = append(parts, fmt.Sprintf("reports(interval=%s)", c.Reports.Interval))
+	}
+	if !c.TWCC.Disabled {
+		parts = append(parts, fmt.Sprintf("twcc(interval=%s)", c.TWCC.Interval))
+	}
+	return strings.Join(parts, " ")
+}
+
+// Meta describes the pipeline for report headers.
+func (c Config) Meta() map[string]string {
+	name := c.Name
+	if name == "" {
+		name = "default"
+	}
+	return map[string]string{"pipeline": name, "interceptors": c.String()}
+}
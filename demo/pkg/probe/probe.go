@@ -0,0 +1,238 @@
+// Package probe sends bandwidth probes: short clusters of padding-only RTP
+// packets at a bitrate above the current estimate, so that the estimator
+// sees the capacity of the path without waiting for the media to ramp up.
+package probe
+
+import (
+	"bwe/demo/pkg/pacer"
+	"sync"
+	"time"
+
+	"github.com/pion/interceptor"
+	"github.com/pion/rtp"
+)
+
+type Config struct {
+	// InitialFactors scale the estimate for the clusters sent once the
+	// connection is up, one after the other.
+	InitialFactors []float64 `yaml:"initial_factors"`
+	// Factor scales the estimate for the periodic clusters.
+	Factor float64 `yaml:"factor"`
+	// Interval is the time between periodic clusters, zero for none.
+	Interval time.Duration `yaml:"interval"`
+	// ClusterDuration is how long the packets of a cluster are spread over.
+	ClusterDuration time.Duration `yaml:"cluster_duration"`
+	// ResultDelay is how long after a cluster its effect on the estimate is
+	// read, enough for the feedback to return.
+	ResultDelay time.Duration `yaml:"result_delay"`
+}
+
+func (c Config) WithDefaults() Config {
+	if len(c.InitialFactors) == 0 {
+		c.InitialFactors = []float64{3, 6}
+	}
+	if c.Factor <= 0 {
+		c.Factor = 2
+	}
+	if c.ClusterDuration <= 0 {
+		c.ClusterDuration = 30 * time.Millisecond
+	}
+	if c.ResultDelay <= 0 {
+		c.ResultDelay = time.Second
+	}
+	return c
+}
+
+const (
+	// step is how often a cluster sends its next packets.
+	step = 5 * time.Millisecond
+	// paddingSize is the most an RTP padding length octet can express.
+	paddingSize = 255
+)
+
+// padding is the payload of every probe packet: zeros ending in the padding
+// length, which counts itself.
+var padding = func() []byte {
+	b := make([]byte, paddingSize)
+	b[paddingSize-1] = paddingSize
+	return b
+}()
+
+// NewPeerConnectionCallback receives the prober created for a peer
+// connection.
+type NewPeerConnectionCallback func(id string, prober *Prober)
+
+// InterceptorFactory builds a Prober per peer connection. It has to run
+// outside the NACK responder and the TWCC sender, so that probes are
+// numbered and acknowledged like media.
+type InterceptorFactory struct {
+	onNewPeerConnection NewPeerConnectionCallback
+}
+
+func NewInterceptor() *InterceptorFactory {
+	return &InterceptorFactory{}
+}
+
+// OnNewPeerConnection sets the callback invoked for every new prober.
+func (f *InterceptorFactory) OnNewPeerConnection(cb NewPeerConnectionCallback) {
+	f.onNewPeerConnection = cb
+}
+
+func (f *InterceptorFactory) NewInterceptor(id string) (interceptor.Interceptor, error) {
+	p := &Prober{streams: map[uint32]*stream{}}
+	if f.onNewPeerConnection != nil {
+		f.onNewPeerConnection(id, p)
+	}
+	return p, nil
+}
+
+// Prober inserts probe packets into the local streams of a peer connection.
+// Probes take sequence numbers from the stream they are sent on, so every
+// later media packet of that stream is renumbered past them.
+type Prober struct {
+	interceptor.NoOp
+
+	mu       sync.Mutex
+	streams  map[uint32]*stream
+	clusters int
+}
+
+type stream struct {
+	ssrc   uint32
+	writer interceptor.RTPWriter
+
+	mu          sync.Mutex
+	started     bool
+	offset      uint16
+	seq         uint16
+	timestamp   uint32
+	payloadType uint8
+	// boundary is set while the last packet ended a frame. Probes go only
+	// between frames, so they never split the packets of one.
+	boundary bool
+}
+
+func (p *Prober) BindLocalStream(info *interceptor.StreamInfo, writer interceptor.RTPWriter) interceptor.RTPWriter {
+	s := &stream{ssrc: info.SSRC, writer: writer}
+	p.mu.Lock()
+	p.streams[info.SSRC] = s
+	p.mu.Unlock()
+	return s
+}
+
+func (p *Prober) UnbindLocalStream(info *interceptor.StreamInfo) {
+	p.mu.Lock()
+	delete(p.streams, info.SSRC)
+	p.mu.Unlock()
+}
+
+func (s *stream) Write(header *rtp.Header, payload []byte, attributes interceptor.Attributes) (int, error) {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+
+	h := *header
+	h.SequenceNumber += s.offset
+	s.started = true
+	s.seq = h.SequenceNumber
+	s.timestamp = h.Timestamp
+	s.payloadType = h.PayloadType
+	s.boundary = h.Marker
+	return s.writer.Write(&h, payload, attributes)
+}
+
+// pad sends one probe packet with the timestamp of the last frame. It
+// returns the bytes sent, zero when the stream is inside a frame.
+func (s *stream) pad(cluster int) int {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+
+	if !s.started || !s.boundary {
+		return 0
+	}
+	s.offset++
+	s.seq++
+
+	header := rtp.Header{
+		Version:        2,
+		Padding:        true,
+		PayloadType:    s.payloadType,
+		SequenceNumber: s.seq,
+		Timestamp:      s.timestamp,
+		SSRC:           s.ssrc,
+	}
+	attributes := interceptor.Attributes{}
+	attributes.Set(pacer.ProbeAttributesKey, cluster)
+	n, err := s.writer.Write(&header, padding, attributes)
+	if err != nil {
+		return 0
+	}
+	return n
+}
+
+// Cluster is the outcome of one probe cluster.
+type Cluster struct {
+	ID      int
+	Bitrate int
+	Packets int
+	Bytes   int
+	// Duration is from the first to the last step of the cluster.
+	Duration time.Duration
+}
+
+// SentBitrate is the bitrate the cluster achieved.
+func (c Cluster) SentBitrate() int {
+	if c.Duration <= 0 {
+		return 0
+	}
+	return int(float64(c.Bytes*8) / c.Duration.Seconds())
+}
+
+// Probe sends a cluster at bitrate spread over duration, round robin over
+// the streams. It blocks until the cluster is sent or done is closed.
+func (p *Prober) Probe(done <-chan struct{}, bitrate int, duration time.Duration) Cluster {
+	p.mu.Lock()
+	p.clusters++
+	cluster := Cluster{ID: p.clusters, Bitrate: bitrate}
+	streams := make([]*stream, 0, len(p.streams))
+	for _, s := range p.streams {
+		streams = append(streams, s)
+	}
+	p.mu.Unlock()
+
+	steps := max(int(duration/step), 1)
+	perStep := float64(bitrate) / 8 * duration.Seconds() / float64(steps)
+
+	ticker := time.NewTicker(step)
+	defer ticker.Stop()
+
+	start := time.Now()
+	budget := 0.0
+	next := 0
+	for i := 0; i < steps; i++ {
+		if i > 0 {
+			select {
+			case <-done:
+				return cluster
+			case <-ticker.C:
+			}
+		}
+
+		// A cluster catches up on a step skipped mid-frame, but not more.
+		budget = min(budget+perStep, 2*perStep)
+		for budget > 0 {
+			n := 0
+			for tried := 0; tried < len(streams) && n == 0; tried++ {
+				n = streams[next].pad(cluster.ID)
+				next = (next + 1) % len(streams)
+			}
+			if n == 0 {
+				break
+			}
+			budget -= float64(n)
+			cluster.Packets++
+			cluster.Bytes += n
+		}
+		cluster.Duration = time.Since(start) + step
+	}
+	return cluster
+}
@@ -0,0 +1,73 @@
+package report
+
+import (
+	"sync"
+	"sync/atomic"
+)
+
+// Queue hands records to a dedicated goroutine that writes them, so that
+// producers never wait for file I/O. Records pushed while the queue is full
+// are dropped and counted.
+type Queue struct {
+	writer  *Writer
+	records chan Record
+	dropped atomic.Uint64
+	failed  atomic.Uint64
+
+	closeOnce sync.Once
+	wg        sync.WaitGroup
+}
+
+func NewQueue(writer *Writer, size int) *Queue {
+	q := &Queue{
+		writer:  writer,
+		records: make(chan Record, max(size, 1)),
+	}
+
+	q.wg.Add(1)
+	go q.run()
+
+	return q
+}
+
+// Push enqueues the record and reports whether it was accepted.
+func (q *Queue) Push(record Record) bool {
+	select {
+	case q.records <- record:
+		return true
+	default:
+		q.dropped.Add(1)
+		return false
+	}
+}
+
+// Dropped returns the number of records dropped because the queue was full.
+func (q *Queue) Dropped() uint64 {
+	return q.dropped.Load()
+}
+
+// Failed returns the number of records the writer failed to write.
+func (q *Queue) Failed() uint64 {
+	return q.failed.Load()
+}
+
+func (q *Queue) run() {
+	defer q.wg.Done()
+	for record := range q.records {
+		if err := q.writer.Write(record); err != nil {
+			q.failed.Add(1)
+		}
+	}
+}
+
+// Close writes the queued records and closes the writer. Push must not be
+// called afterwards.
+func (q *Queue) Close() error {
+	var err error
+	q.closeOnce.Do(func() {
+		close(q.records)
+		q.wg.Wait()
+		err = q.writer.Close()
+	})
+	return err
+}
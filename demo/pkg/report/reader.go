@@ -0,0 +1,237 @@
+package report
+
+import (
+	"bufio"
+	"bytes"
+	"encoding/binary"
+	"encoding/json"
+	"errors"
+	"fmt"
+	"io"
+	"math"
+)
+
+// Reader reads a report one record at a time, in either format, so a file
+// of any length is processed in constant memory.
+type Reader struct {
+	format Format
+	fields []Field
+	meta   map[string]string
+
+	buffer *bufio.Reader
+	record []byte
+
+	line    []byte
+	decoded map[string]float64
+}
+
+func NewReader(r io.Reader) (*Reader, error) {
+	reader := &Reader{buffer: bufio.NewReaderSize(r, bufferSize)}
+
+	prefix, err := reader.buffer.Peek(len(magic))
+	if err != nil && !errors.Is(err, io.EOF) {
+		return nil, fmt.Errorf("read magic: %w", err)
+	}
+
+	if string(prefix) == magic {
+		reader.format = FormatBinary
+		err = reader.readHeader()
+	} else {
+		reader.format = FormatJSON
+		err = reader.readFirstLine()
+	}
+	if err != nil {
+		return nil, err
+	}
+
+	return reader, nil
+}
+
+func (r *Reader) readHeader() error {
+	head := make([]byte, len(magic)+4)
+	if _, err := io.ReadFull(r.buffer, head); err != nil {
+		return fmt.Errorf("read header length: %w", err)
+	}
+
+	header := make([]byte, binary.LittleEndian.Uint32(head[len(magic):]))
+	if _, err := io.ReadFull(r.buffer, header); err != nil {
+		return fmt.Errorf("read header: %w", err)
+	}
+
+	var decoded struct {
+		Fields [][2]string       `json:"fields"`
+		Meta   map[string]string `json:"meta"`
+	}
+	if err := json.Unmarshal(header, &decoded); err != nil {
+		return fmt.Errorf("unmarshal header: %w", err)
+	}
+
+	size := 0
+	for _, field := range decoded.Fields {
+		width, ok := fieldWidths[field[1]]
+		if !ok {
+			return fmt.Errorf("unknown field type %s of %s", field[1], field[0])
+		}
+		r.fields = append(r.fields, Field{Name: field[0], Type: field[1]})
+		size += width
+	}
+	r.record = make([]byte, size)
+	r.meta = decoded.Meta
+
+	return nil
+}
+
+// readFirstLine takes the fields of a JSON report from the key order of its
+// first record, after the meta line if there is one.
+func (r *Reader) readFirstLine() error {
+	line, err := r.readLine()
+	if errors.Is(err, io.EOF) {
+		return nil
+	}
+	if err != nil {
+		return err
+	}
+
+	var meta metaLine
+	if bytes.HasPrefix(bytes.TrimSpace(line), []byte(`{"meta":`)) && json.Unmarshal(line, &meta) == nil {
+		r.meta = meta.Meta
+		line, err = r.readLine()
+		if errors.Is(err, io.EOF) {
+			return nil
+		}
+		if err != nil {
+			return err
+		}
+	}
+
+	decoder := json.NewDecoder(bytes.NewReader(line))
+	if _, err = decoder.Token(); err != nil {
+		return fmt.Errorf("decode first record: %w", err)
+	}
+	for decoder.More() {
+		key, err := decoder.Token()
+		if err != nil {
+			return fmt.Errorf("decode first record: %w", err)
+		}
+		var value json.RawMessage
+		if err = decoder.Decode(&value); err != nil {
+			return fmt.Errorf("decode first record: %w", err)
+		}
+		r.fields = append(r.fields, Field{Name: key.(string), Type: "<f8"})
+	}
+
+	r.line = line
+	return nil
+}
+
+func (r *Reader) readLine() ([]byte, error) {
+	for {
+		line, err := r.buffer.ReadBytes('\n')
+		if len(bytes.TrimSpace(line)) > 0 && err == nil {
+			return line, nil
+		}
+		if err != nil {
+			// A report that is still being written may end in a partial line.
+			return nil, err
+		}
+	}
+}
+
+// Meta returns the metadata the report was written with.
+func (r *Reader) Meta() map[string]string {
+	return r.meta
+}
+
+// Fields lists the record fields in the order Next fills values.
+func (r *Reader) Fields() []Field {
+	return r.fields
+}
+
+// Index returns the position of the named field, or -1.
+func (r *Reader) Index(name string) int {
+	for i, field := range r.fields {
+		if field.Name == name {
+			return i
+		}
+	}
+	return -1
+}
+
+// Next reads the following record into values, one per field, converted to
+// float64. It returns io.EOF after the last complete record.
+func (r *Reader) Next(values []float64) error {
+	if len(values) < len(r.fields) {
+		return fmt.Errorf("%d values for %d fields", len(values), len(r.fields))
+	}
+
+	if r.format == FormatBinary {
+		return r.nextBinary(values)
+	}
+	return r.nextJSON(values)
+}
+
+func (r *Reader) nextBinary(values []float64) error {
+	_, err := io.ReadFull(r.buffer, r.record)
+	if errors.Is(err, io.ErrUnexpectedEOF) {
+		return io.EOF
+	}
+	if err != nil {
+		return err
+	}
+
+	b := r.record
+	for i, field := range r.fields {
+		var value float64
+		switch field.Type {
+		case "<i8":
+			value = float64(int64(binary.LittleEndian.Uint64(b)))
+		case "<u8":
+			value = float64(binary.LittleEndian.Uint64(b))
+		case "<f8":
+			value = math.Float64frombits(binary.LittleEndian.Uint64(b))
+		case "<i4":
+			value = float64(int32(binary.LittleEndian.Uint32(b)))
+		case "<u4":
+			value = float64(binary.LittleEndian.Uint32(b))
+		case "<u2":
+			value = float64(binary.LittleEndian.Uint16(b))
+		case "<u1":
+			value = float64(b[0])
+		}
+		values[i] = value
+		b = b[fieldWidths[field.Type]:]
+	}
+
+	return nil
+}
+
+func (r *Reader) nextJSON(values []float64) error {
+	line := r.line
+	r.line = nil
+	if line == nil {
+		var err error
+		line, err = r.readLine()
+		if err != nil {
+			return err
+		}
+	}
+
+	if r.decoded == nil {
+		r.decoded = make(map[string]float64, len(r.fields))
+	}
+	if err := json.Unmarshal(line, &r.decoded); err != nil {
+		return fmt.Errorf("decode record: %w", err)
+	}
+
+	for i, field := range r.fields {
+		values[i] = r.decoded[field.Name]
+	}
+	return nil
+}
+
+var fieldWidths = map[string]int{
+	"<i8": 8, "<u8": 8, "<f8": 8,
+	"<i4": 4, "<u4": 4,
+	"<u2": 2,
+	"<u1": 1,
+}
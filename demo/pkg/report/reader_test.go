@@ -0,0 +1,117 @@
+package report
+
+import (
+	"errors"
+	"io"
+	"os"
+	"path/filepath"
+	"testing"
+)
+
+type testRecord struct {
+	Timestamp int64   `json:"timestamp"`
+	SSRC      uint32  `json:"ssrc"`
+	Loss      float64 `json:"loss"`
+	Layer     uint8   `json:"layer"`
+}
+
+func (r testRecord) AppendBinary(b []byte) []byte {
+	b = AppendInt64(b, r.Timestamp)
+	b = AppendUint32(b, r.SSRC)
+	b = AppendFloat64(b, r.Loss)
+	return AppendUint8(b, r.Layer)
+}
+
+var testSchema = []Field{
+	{"timestamp", "<i8"},
+	{"ssrc", "<u4"},
+	{"loss", "<f8"},
+	{"layer", "<u1"},
+}
+
+// TestReaderRoundTrip checks that records and metadata written in either
+// format read back with the fields in schema order, and that a partial
+// record at the end of a report still being written is not returned.
+func TestReaderRoundTrip(t *testing.T) {
+	records := []testRecord{
+		{Timestamp: -5, SSRC: 1 << 31, Loss: 0.25, Layer: 2},
+		{Timestamp: 1700000000000, SSRC: 7, Loss: 0, Layer: 0},
+	}
+	meta := map[string]string{"pipeline": "gcc,nack"}
+
+	for _, format := range []Format{FormatJSON, FormatBinary} {
+		t.Run(string(format), func(t *testing.T) {
+			path := filepath.Join(t.TempDir(), "report")
+			w, err := NewWriter(path, format, testSchema, meta, 0)
+			if err != nil {
+				t.Fatal(err)
+			}
+			for _, record := range records {
+				if err = w.Write(record); err != nil {
+					t.Fatal(err)
+				}
+			}
+			if err = w.Close(); err != nil {
+				t.Fatal(err)
+			}
+
+			// Half a record, as a writer leaves it between flushes.
+			file, err := os.OpenFile(path, os.O_APPEND|os.O_WRONLY, 0)
+			if err != nil {
+				t.Fatal(err)
+			}
+			if format == FormatBinary {
+				_, err = file.Write(records[0].AppendBinary(nil)[:10])
+			} else {
+				_, err = file.WriteString(`{"timestamp":3,"ss`)
+			}
+			if err != nil {
+				t.Fatal(err)
+			}
+			if err = file.Close(); err != nil {
+				t.Fatal(err)
+			}
+
+			file, err = os.Open(path)
+			if err != nil {
+				t.Fatal(err)
+			}
+			defer file.Close()
+			r, err := NewReader(file)
+			if err != nil {
+				t.Fatal(err)
+			}
+
+			if r.Meta()["pipeline"] != "gcc,nack" {
+				t.Fatalf("meta %v", r.Meta())
+			}
+			if len(r.Fields()) != len(testSchema) {
+				t.Fatalf("fields %v", r.Fields())
+			}
+			for i, field := range testSchema {
+				if r.Index(field.Name) != i {
+					t.Fatalf("index of %s %d, want %d", field.Name, r.Index(field.Name), i)
+				}
+			}
+			if r.Index("missing") != -1 {
+				t.Fatalf("index of a missing field %d", r.Index("missing"))
+			}
+
+			values := make([]float64, len(r.Fields()))
+			for _, record := range records {
+				if err = r.Next(values); err != nil {
+					t.Fatal(err)
+				}
+				want := []float64{float64(record.Timestamp), float64(record.SSRC), record.Loss, float64(record.Layer)}
+				for i := range want {
+					if values[i] != want[i] {
+						t.Fatalf("values %v, want %v", values, want)
+					}
+				}
+			}
+			if err = r.Next(values); !errors.Is(err, io.EOF) {
+				t.Fatalf("after the last record got %v, want EOF", err)
+			}
+		})
+	}
+}
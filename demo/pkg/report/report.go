@@ -0,0 +1,248 @@
+// Package report writes stats records to a file through a buffered writer,
+// either as JSON lines or as fixed-width little-endian binary records.
+//
+// A binary report starts with the magic "BWESTATS", a uint32 header length
+// and a JSON header listing the record fields in numpy dtype notation, e.g.
+// {"fields":[["timestamp","<i8"],["ssrc","<u4"]]}. Records follow back to
+// back, so the file can be loaded with a single numpy.frombuffer call.
+//
+// Metadata such as the interceptor pipeline of the run goes under "meta" in
+// the binary header, and into a leading {"meta":{...}} line of JSON reports.
+package report
+
+import (
+	"bufio"
+	"bytes"
+	"encoding/binary"
+	"encoding/json"
+	"fmt"
+	"math"
+	"os"
+	"sync"
+	"time"
+)
+
+type Format string
+
+const (
+	FormatJSON   Format = "json"
+	FormatBinary Format = "binary"
+)
+
+const magic = "BWESTATS"
+
+const bufferSize = 64 * 1024
+
+// Field is a column of a binary record.
+type Field struct {
+	Name string
+	// Type is a numpy dtype string such as "<i8" or "<f8".
+	Type string
+}
+
+// Record is a row of a report. AppendBinary appends the fields in the order
+// and with the widths of the schema the writer was created with.
+type Record interface {
+	AppendBinary(b []byte) []byte
+}
+
+// Writer buffers records in memory and writes them out in batches, when the
+// buffer fills up and every flush interval.
+type Writer struct {
+	file   *os.File
+	format Format
+
+	mu      sync.Mutex
+	buffer  *bufio.Writer
+	encoder *json.Encoder
+	record  []byte
+	err     error
+
+	done chan struct{}
+	wg   sync.WaitGroup
+}
+
+func NewWriter(path string, format Format, schema []Field, meta map[string]string, flushInterval time.Duration) (*Writer, error) {
+	if format == "" {
+		format = FormatJSON
+	}
+	if format != FormatJSON && format != FormatBinary {
+		return nil, fmt.Errorf("unknown report format %s", format)
+	}
+
+	file, err := os.Create(path)
+	if err != nil {
+		return nil, fmt.Errorf("create report file: %w", err)
+	}
+
+	w := &Writer{
+		file:   file,
+		format: format,
+		buffer: bufio.NewWriterSize(file, bufferSize),
+		done:   make(chan struct{}),
+	}
+	w.encoder = json.NewEncoder(w.buffer)
+
+	if format == FormatBinary {
+		err = w.writeHeader(schema, meta)
+	} else if len(meta) > 0 {
+		err = w.encoder.Encode(metaLine{meta})
+	}
+	if err != nil {
+		_ = file.Close()
+		return nil, err
+	}
+
+	if flushInterval > 0 {
+		w.wg.Add(1)
+		go w.flushLoop(flushInterval)
+	}
+
+	return w, nil
+}
+
+type metaLine struct {
+	Meta map[string]string `json:"meta"`
+}
+
+func (w *Writer) writeHeader(schema []Field, meta map[string]string) error {
+	fields := make([][2]string, len(schema))
+	for i, field := range schema {
+		fields[i] = [2]string{field.Name, field.Type}
+	}
+
+	var header bytes.Buffer
+	encoder := json.NewEncoder(&header)
+	encoder.SetEscapeHTML(false)
+	err := encoder.Encode(struct {
+		Fields [][2]string       `json:"fields"`
+		Meta   map[string]string `json:"meta,omitempty"`
+	}{fields, meta})
+	if err != nil {
+		return fmt.Errorf("marshal header: %w", err)
+	}
+
+	b := append([]byte(magic), 0, 0, 0, 0)
+	binary.LittleEndian.PutUint32(b[len(magic):], uint32(header.Len()))
+	b = append(b, header.Bytes()...)
+
+	_, err = w.buffer.Write(b)
+	if err != nil {
+		return fmt.Errorf("write header: %w", err)
+	}
+	return nil
+}
+
+// Write appends the record to the buffer. JSON records are encoded with
+// encoding/json, so Record must also be a JSON-tagged struct.
+func (w *Writer) Write(record Record) error {
+	w.mu.Lock()
+	defer w.mu.Unlock()
+
+	if w.err != nil {
+		return w.err
+	}
+
+	if w.format == FormatJSON {
+		err := w.encoder.Encode(record)
+		if err != nil {
+			return fmt.Errorf("encode json: %w", err)
+		}
+		return nil
+	}
+
+	w.record = record.AppendBinary(w.record[:0])
+	_, err := w.buffer.Write(w.record)
+	if err != nil {
+		w.err = fmt.Errorf("write record: %w", err)
+		return w.err
+	}
+	return nil
+}
+
+// WriteBinary appends records already encoded in the binary layout of the
+// schema. It is only valid for binary reports.
+func (w *Writer) WriteBinary(records []byte) error {
+	w.mu.Lock()
+	defer w.mu.Unlock()
+
+	if w.err != nil {
+		return w.err
+	}
+	if w.format != FormatBinary {
+		return fmt.Errorf("write binary to %s report", w.format)
+	}
+
+	_, err := w.buffer.Write(records)
+	if err != nil {
+		w.err = fmt.Errorf("write records: %w", err)
+		return w.err
+	}
+	return nil
+}
+
+// Flush writes all buffered records to the file.
+func (w *Writer) Flush() error {
+	w.mu.Lock()
+	defer w.mu.Unlock()
+
+	err := w.buffer.Flush()
+	if err != nil {
+		return fmt.Errorf("flush: %w", err)
+	}
+	return nil
+}
+
+func (w *Writer) flushLoop(interval time.Duration) {
+	defer w.wg.Done()
+
+	ticker := time.NewTicker(interval)
+	defer ticker.Stop()
+	for {
+		select {
+		case <-w.done:
+			return
+		case <-ticker.C:
+			_ = w.Flush()
+		}
+	}
+}
+
+// Close flushes the buffer and closes the file.
+func (w *Writer) Close() error {
+	close(w.done)
+	w.wg.Wait()
+
+	err := w.Flush()
+	if err != nil {
+		_ = w.file.Close()
+		return err
+	}
+	return w.file.Close()
+}
+
+// AppendInt64 and friends append little-endian values for AppendBinary.
+
+func AppendUint8(b []byte, v uint8) []byte {
+	return append(b, v)
+}
+
+func AppendUint16(b []byte, v uint16) []byte {
+	return binary.LittleEndian.AppendUint16(b, v)
+}
+
+func AppendInt64(b []byte, v int64) []byte {
+	return binary.LittleEndian.AppendUint64(b, uint64(v))
+}
+
+func AppendUint64(b []byte, v uint64) []byte {
+	return binary.LittleEndian.AppendUint64(b, v)
+}
+
+func AppendUint32(b []byte, v uint32) []byte {
+	return binary.LittleEndian.AppendUint32(b, v)
+}
+
+func AppendFloat64(b []byte, v float64) []byte {
+	return binary.LittleEndian.AppendUint64(b, math.Float64bits(v))
+}
@@ -0,0 +1,207 @@
+// Package rtpcache packetizes videos of the frame store once into RTP
+// payloads, so that sessions send shared payloads instead of running the
+// payloader on every frame.
+package rtpcache
+
+import (
+	"bwe/demo/pkg/framestore"
+	"fmt"
+	"sync"
+
+	"github.com/pion/rtp"
+	"github.com/pion/rtp/codecs"
+)
+
+// DefaultMTU matches the outbound MTU of pion tracks.
+const DefaultMTU = 1200
+
+const (
+	rtpHeaderSize = 12
+	// ClockRate is the RTP clock rate of every video codec.
+	ClockRate = 90000
+	// vp8PictureIDGrowth is how much longer a VP8 payload descriptor gets
+	// with a 15-bit picture ID than without one.
+	vp8PictureIDGrowth = 3
+)
+
+// Video is a video packetized for a fixed MTU. It is immutable and safe for
+// concurrent use.
+type Video struct {
+	*framestore.Video
+
+	data     []byte
+	payloads [][]byte
+	frames   []int
+}
+
+// Payloads returns the RTP payloads of the i-th frame in send order; the
+// last one carries the marker bit. The slices borrow the shared buffer and
+// must not be modified.
+func (v *Video) Payloads(i int) [][]byte {
+	return v.payloads[v.frames[i]:v.frames[i+1]]
+}
+
+// NewPayloader returns the payloader pion tracks use for the FourCC.
+func NewPayloader(fourCC string) (rtp.Payloader, error) {
+	switch fourCC {
+	case "VP80":
+		return &codecs.VP8Payloader{EnablePictureID: true}, nil
+	case "VP90":
+		return &codecs.VP9Payloader{}, nil
+	case "AV01":
+		return &codecs.AV1Payloader{}, nil
+	default:
+		return nil, fmt.Errorf("unable to handle FourCC %s", fourCC)
+	}
+}
+
+// Packetize splits every frame of the video into payloads that fit into mtu
+// with the RTP header, and with the picture ID AppendPictureID sets.
+func Packetize(video *framestore.Video, mtu int) (*Video, error) {
+	payloader, err := NewPayloader(video.Header.FourCC)
+	if err != nil {
+		return nil, err
+	}
+	payloadSize := mtu - rtpHeaderSize
+	if video.Header.FourCC == "VP80" {
+		payloadSize -= vp8PictureIDGrowth
+	}
+	if payloadSize <= 0 {
+		return nil, fmt.Errorf("mtu %d too small", mtu)
+	}
+
+	v := &Video{
+		Video:  video,
+		frames: make([]int, 0, video.FrameCount()+1),
+	}
+
+	for i := 0; i < video.FrameCount(); i++ {
+		v.frames = append(v.frames, len(v.payloads))
+		v.payloads = append(v.payloads, payloader.Payload(uint16(payloadSize), video.Frame(i))...)
+	}
+	v.frames = append(v.frames, len(v.payloads))
+
+	// The payloads are moved into one buffer, which replaces an allocation
+	// per packet with one per video.
+	size := 0
+	for _, payload := range v.payloads {
+		size += len(payload)
+	}
+	v.data = make([]byte, 0, size)
+	for i, payload := range v.payloads {
+		start := len(v.data)
+		v.data = append(v.data, payload...)
+		v.payloads[i] = v.data[start:len(v.data):len(v.data)]
+	}
+
+	return v, nil
+}
+
+// HasPictureID reports whether payloads of the FourCC carry a picture ID
+// that AppendPictureID rewrites.
+func HasPictureID(fourCC string) bool {
+	return fourCC == "VP80" || fourCC == "VP90"
+}
+
+// AppendPictureID appends payload to dst with the picture ID of its payload
+// descriptor set to id. Cached payloads carry the picture IDs they were
+// packetized with, which would repeat at every loop and keyframe jump, so
+// tracks number their frames themselves. VP8 descriptors get a 15-bit
+// picture ID whatever they had before. Payloads without a picture ID are
+// appended as they are.
+func AppendPictureID(dst []byte, fourCC string, payload []byte, id uint16) []byte {
+	switch fourCC {
+	case "VP80":
+		return appendVP8PictureID(dst, payload, id)
+	case "VP90":
+		return appendVP9PictureID(dst, payload, id)
+	}
+	return append(dst, payload...)
+}
+
+// appendVP8PictureID rewrites the descriptor of RFC 7741: a byte with the X
+// bit, an extension byte with the I bit, and a picture ID of one byte, or
+// two with the M bit.
+func appendVP8PictureID(dst, payload []byte, id uint16) []byte {
+	if len(payload) == 0 {
+		return dst
+	}
+	rest := payload[1:]
+	var extension byte
+	if payload[0]&0x80 != 0 {
+		if len(rest) == 0 {
+			return append(dst, payload...)
+		}
+		extension, rest = rest[0], rest[1:]
+		if extension&0x80 != 0 {
+			n := 1
+			if len(rest) > 0 && rest[0]&0x80 != 0 {
+				n = 2
+			}
+			if len(rest) < n {
+				return append(dst, payload...)
+			}
+			rest = rest[n:]
+		}
+	}
+
+	dst = append(dst, payload[0]|0x80, extension|0x80, 0x80|byte(id>>8), byte(id))
+	return append(dst, rest...)
+}
+
+// appendVP9PictureID rewrites the 15-bit picture ID that follows the first
+// descriptor byte when its I bit is set.
+func appendVP9PictureID(dst, payload []byte, id uint16) []byte {
+	start := len(dst)
+	dst = append(dst, payload...)
+	if len(payload) < 3 || payload[0]&0x80 == 0 || payload[1]&0x80 == 0 {
+		return dst
+	}
+	dst[start+1] = 0x80 | byte(id>>8)
+	dst[start+2] = byte(id)
+	return dst
+}
+
+type entry struct {
+	once  sync.Once
+	video *Video
+	err   error
+}
+
+// Store caches packetized videos for one MTU.
+type Store struct {
+	mtu int
+
+	mu      sync.Mutex
+	entries map[*framestore.Video]*entry
+}
+
+func New(mtu int) *Store {
+	if mtu <= 0 {
+		mtu = DefaultMTU
+	}
+	return &Store{mtu: mtu, entries: make(map[*framestore.Video]*entry)}
+}
+
+// Get returns the video packetized, packetizing it on first use.
+func (s *Store) Get(video *framestore.Video) (*Video, error) {
+	s.mu.Lock()
+	e, ok := s.entries[video]
+	if !ok {
+		e = &entry{}
+		s.entries[video] = e
+	}
+	s.mu.Unlock()
+
+	e.once.Do(func() {
+		e.video, e.err = Packetize(video, s.mtu)
+	})
+	return e.video, e.err
+}
+
+// Remove drops the packetized video, once the frame store freed it.
+func (s *Store) Remove(video *framestore.Video) {
+	s.mu.Lock()
+	delete(s.entries, video)
+	s.mu.Unlock()
+}
@@ -0,0 +1,36 @@
+package rtpcache
+
+import (
+	"bytes"
+	"testing"
+)
+
+// TestAppendPictureID checks that VP8 descriptors without, with a 7-bit and
+// with a 15-bit picture ID all get the 15-bit one, and that VP9 keeps its
+// layout.
+func TestAppendPictureID(t *testing.T) {
+	const id = 0x1234
+	want := []byte{0x90, 0x80, 0x80 | 0x12, 0x34, 0xaa, 0xbb}
+	for _, payload := range [][]byte{
+		{0x10, 0xaa, 0xbb},
+		{0x90, 0x80, 0x05, 0xaa, 0xbb},
+		{0x90, 0x80, 0x80 | 0x7f, 0xff, 0xaa, 0xbb},
+	} {
+		if got := AppendPictureID(nil, "VP80", payload, id); !bytes.Equal(got, want) {
+			t.Errorf("VP8 % x: got % x, want % x", payload, got, want)
+		}
+	}
+
+	vp9 := []byte{0x88, 0x80 | 0x01, 0x02, 0xaa}
+	if got := AppendPictureID(nil, "VP90", vp9, id); !bytes.Equal(got, []byte{0x88, 0x80 | 0x12, 0x34, 0xaa}) {
+		t.Errorf("VP9: got % x", got)
+	}
+	if vp9[1] != 0x81 || vp9[2] != 0x02 {
+		t.Error("VP9 payload modified in place")
+	}
+
+	av1 := []byte{0x10, 0xaa}
+	if got := AppendPictureID(nil, "AV01", av1, id); !bytes.Equal(got, av1) {
+		t.Errorf("AV1: got % x", got)
+	}
+}
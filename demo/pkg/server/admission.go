@@ -0,0 +1,177 @@
+package server
+
+import (
+	"bwe/demo/pkg/framestore"
+	"errors"
+	"log/slog"
+	"sync"
+	"sync/atomic"
+	"time"
+)
+
+var (
+	errSessionLimit = errors.New("session limit reached")
+	errEgressBudget = errors.New("egress bitrate budget exhausted")
+	errOverloaded   = errors.New("server overloaded")
+	errUnmeasured   = errors.New("upstream bitrate not measured yet")
+)
+
+// admission decides whether /watch takes a new session before any peer
+// connection state is allocated. Each session reserves the bitrate of what
+// it will be sent until it ends.
+type admission struct {
+	config AdmissionConfig
+
+	mu sync.Mutex
+	// full is the bitrate of a session sent everything, lowest of one sent
+	// only the cheapest rendition.
+	full   int
+	lowest int
+	// unmeasured is set on edges until the bitrate of the upstream tracks
+	// is known.
+	unmeasured bool
+	sessions   int
+	egress     int
+
+	overloaded atomic.Bool
+	done       chan struct{}
+	wg         sync.WaitGroup
+}
+
+// grant is an admitted session's reservation.
+type grant struct {
+	bitrate int
+	// lowest limits the session to the cheapest rendition.
+	lowest bool
+}
+
+// newAdmission reserves the sum of the videos per session, or the top layer
+// when sessions adapt to the bandwidth estimate.
+func newAdmission(config AdmissionConfig, videos []*framestore.Video, adaptive bool) *admission {
+	a := &admission{config: config, done: make(chan struct{})}
+	for i, video := range videos {
+		bitrate := video.Bitrate()
+		if adaptive {
+			a.full = max(a.full, bitrate)
+		} else {
+			a.full += bitrate
+		}
+		if i == 0 || bitrate < a.lowest {
+			a.lowest = bitrate
+		}
+	}
+	return a
+}
+
+// relay makes the bitrate of the upstream tracks the reservation of a
+// session. Edge viewers are sent every relayed track, the local videos
+// play no part.
+func (a *admission) relay() {
+	a.mu.Lock()
+	defer a.mu.Unlock()
+	a.full, a.lowest = 0, 0
+	a.unmeasured = true
+}
+
+// setRelayBitrate takes a new measurement of all upstream tracks and of the
+// cheapest one, which degraded sessions are sent. Sessions admitted keep
+// their reservation.
+func (a *admission) setRelayBitrate(full, lowest int) {
+	a.mu.Lock()
+	defer a.mu.Unlock()
+	a.full, a.lowest = full, lowest
+	a.unmeasured = false
+}
+
+func (a *admission) admit() (grant, error) {
+	if a.overloaded.Load() {
+		return grant{}, errOverloaded
+	}
+
+	a.mu.Lock()
+	defer a.mu.Unlock()
+
+	if a.config.MaxSessions > 0 && a.sessions >= a.config.MaxSessions {
+		return grant{}, errSessionLimit
+	}
+
+	budget := a.config.MaxEgressBitrate
+	if budget > 0 && a.unmeasured {
+		return grant{}, errUnmeasured
+	}
+
+	g := grant{bitrate: a.full}
+	if budget > 0 && a.egress+g.bitrate > budget {
+		if !a.config.Degrade || a.egress+a.lowest > budget {
+			return grant{}, errEgressBudget
+		}
+		g = grant{bitrate: a.lowest, lowest: true}
+	}
+
+	a.sessions++
+	a.egress += g.bitrate
+	egressReserved.Set(int64(a.egress))
+	return g, nil
+}
+
+func (a *admission) release(g grant) {
+	a.mu.Lock()
+	defer a.mu.Unlock()
+
+	a.sessions--
+	a.egress -= g.bitrate
+	egressReserved.Set(int64(a.egress))
+}
+
+// startShedding refuses new sessions while the server falls behind, checked
+// every ShedInterval. Missed frame ticks mean the send loops do not get
+// enough CPU, a growing pacer backlog that the send path does not keep up.
+func (a *admission) startShedding(sessions *Sessions) {
+	if a.config.MaxTickerOverruns <= 0 && a.config.MaxPacerQueue <= 0 {
+		return
+	}
+
+	interval := a.config.ShedInterval
+	if interval <= 0 {
+		interval = time.Second
+	}
+
+	a.wg.Add(1)
+	go func() {
+		defer a.wg.Done()
+
+		ticker := time.NewTicker(interval)
+		defer ticker.Stop()
+		lastOverruns := tickerOverruns.Value()
+		for {
+			select {
+			case <-a.done:
+				return
+			case <-ticker.C:
+			}
+
+			overruns := tickerOverruns.Value()
+			missed := overruns - lastOverruns
+			lastOverruns = overruns
+
+			queued := sessions.pacerQueued()
+
+			overloaded := a.config.MaxTickerOverruns > 0 && missed > uint64(a.config.MaxTickerOverruns) ||
+				a.config.MaxPacerQueue > 0 && queued > a.config.MaxPacerQueue
+			if a.overloaded.Swap(overloaded) != overloaded {
+				slog.Warn("admission shedding", slog.Bool("overloaded", overloaded),
+					slog.Uint64("ticker_overruns", missed), slog.Int("pacer_queued", queued))
+			}
+			if overloaded {
+				overloadedGauge.Set(1)
+			} else {
+				overloadedGauge.Set(0)
+			}
+		}
+	}()
+}
+
+func (a *admission) close() {
+	close(a.done)
+	a.wg.Wait()
+}
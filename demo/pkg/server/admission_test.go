@@ -0,0 +1,61 @@
+package server
+
+import (
+	"errors"
+	"testing"
+)
+
+// TestAdmissionBudget checks the session limit, the egress budget with and
+// without degradation, and that releases free the reservation.
+func TestAdmissionBudget(t *testing.T) {
+	a := &admission{
+		config: AdmissionConfig{MaxSessions: 3, MaxEgressBitrate: 2500, Degrade: true},
+		full:   1000,
+		lowest: 300,
+	}
+
+	var grants []grant
+	for i, want := range []grant{{bitrate: 1000}, {bitrate: 1000}, {bitrate: 300, lowest: true}} {
+		g, err := a.admit()
+		if err != nil || g != want {
+			t.Fatalf("session %d: %+v, %v, want %+v", i, g, err, want)
+		}
+		grants = append(grants, g)
+	}
+	if _, err := a.admit(); !errors.Is(err, errSessionLimit) {
+		t.Fatalf("fourth session: %v, want %v", err, errSessionLimit)
+	}
+
+	a.release(grants[0])
+	a.config.Degrade = false
+	a.config.MaxEgressBitrate = 2000
+	if _, err := a.admit(); !errors.Is(err, errEgressBudget) {
+		t.Fatalf("over budget without degrade: %v, want %v", err, errEgressBudget)
+	}
+	a.release(grants[2])
+	if g, err := a.admit(); err != nil || g.bitrate != 1000 {
+		t.Fatalf("after releases: %+v, %v", g, err)
+	}
+}
+
+// TestAdmissionRelay checks that an edge refuses sessions until the upstream
+// bitrate is measured and then reserves it, that of the cheapest track for
+// degraded sessions.
+func TestAdmissionRelay(t *testing.T) {
+	a := &admission{config: AdmissionConfig{MaxEgressBitrate: 2000, Degrade: true}, full: 100, lowest: 100}
+	a.relay()
+	if _, err := a.admit(); !errors.Is(err, errUnmeasured) {
+		t.Fatalf("unmeasured: %v, want %v", err, errUnmeasured)
+	}
+
+	a.setRelayBitrate(1500, 400)
+	if g, err := a.admit(); err != nil || g.bitrate != 1500 || g.lowest {
+		t.Fatalf("measured: %+v, %v", g, err)
+	}
+	if g, err := a.admit(); err != nil || g.bitrate != 400 || !g.lowest {
+		t.Fatalf("second session: %+v, %v, want the lowest track", g, err)
+	}
+	if _, err := a.admit(); !errors.Is(err, errEgressBudget) {
+		t.Fatalf("third session: %v, want %v", err, errEgressBudget)
+	}
+}
@@ -0,0 +1,334 @@
+package server
+
+import (
+	"bwe/demo/pkg/attr"
+	"bwe/demo/pkg/framestore"
+	"bwe/demo/pkg/rtpcache"
+	"fmt"
+	"log/slog"
+	"slices"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"github.com/pion/interceptor/pkg/cc"
+	"github.com/pion/rtp"
+	"github.com/pion/webrtc/v4"
+)
+
+// Broadcast plays each video once on a shared track. Sessions attach to the
+// tracks and join the live timeline, so per-viewer cost is only the RTP send.
+// Sessions that switch renditions by their estimate get the packets of the
+// rendition they are on through a track of their own, which keeps their
+// sequence numbers and timestamps continuous across switches.
+type Broadcast struct {
+	renditions []*rendition
+
+	done      chan struct{}
+	closeOnce sync.Once
+	wg        sync.WaitGroup
+}
+
+type rendition struct {
+	layer int
+	// video is the version the producer plays, replaced on reload.
+	video atomic.Pointer[framestore.Video]
+	// track is the shared track; the producer packetizes each frame once
+	// for it and for the viewers on the rendition.
+	track      *webrtc.TrackLocalStaticRTP
+	packetizer rtp.Packetizer
+
+	mu      sync.Mutex
+	waiting []*viewer
+	viewers []*viewer
+}
+
+// viewer is a session that receives a single rendition chosen by its
+// bandwidth estimate.
+type viewer struct {
+	track *webrtc.TrackLocalStaticRTP
+	// renditions are those of the broadcast, their versions change on
+	// reload.
+	renditions []*rendition
+	done       <-chan struct{}
+	log        *slog.Logger
+
+	mu      sync.Mutex
+	current int
+	pending int
+	// rewrite continues the numbering of the track when current changes.
+	rewrite rtpRewriter
+}
+
+// newBroadcast starts a producer per video. When sessions run bandwidth
+// estimation the videos must be ordered as layers, see newLayers.
+func newBroadcast(videos []*framestore.Video, playback Playback) (*Broadcast, error) {
+	b := &Broadcast{done: make(chan struct{})}
+	for i, video := range videos {
+		videoTrack, err := newRTPTrack(video.Header)
+		if err != nil {
+			return nil, fmt.Errorf("new video track %s: %w", video.Path, err)
+		}
+		payloader, err := rtpcache.NewPayloader(video.Header.FourCC)
+		if err != nil {
+			return nil, fmt.Errorf("new payloader %s: %w", video.Path, err)
+		}
+
+		r := &rendition{
+			layer:      i,
+			track:      videoTrack,
+			packetizer: rtp.NewPacketizer(rtpcache.DefaultMTU, 0, 0, payloader, rtp.NewRandomSequencer(), rtpcache.ClockRate),
+		}
+		r.video.Store(video)
+		b.renditions = append(b.renditions, r)
+
+		b.wg.Add(1)
+		go func() {
+			defer b.wg.Done()
+			r.produce(playback, b.done)
+		}()
+	}
+
+	return b, nil
+}
+
+// close stops the producers and waits for them to release their videos.
+func (b *Broadcast) close() {
+	b.closeOnce.Do(func() {
+		close(b.done)
+		b.wg.Wait()
+	})
+}
+
+// Attach adds the broadcast tracks to the peer connection. Without an
+// estimator every rendition is sent, otherwise only the one that fits.
+func (b *Broadcast) Attach(session *Session) error {
+	if session.pc.Estimator == nil {
+		return b.AttachAll(session)
+	}
+
+	return b.attachAdaptive(session, session.pc.Estimator)
+}
+
+// AttachAll adds every rendition to the peer connection.
+func (b *Broadcast) AttachAll(session *Session) error {
+	for _, r := range b.renditions {
+		_, _, err := addTrack(session, r.track)
+		if err != nil {
+			return err
+		}
+	}
+
+	return nil
+}
+
+// AttachLowest adds only the cheapest rendition, which the session keeps
+// regardless of its estimate.
+func (b *Broadcast) AttachLowest(session *Session) error {
+	_, _, err := addTrack(session, b.renditions[lowestVideo(b.videos())].track)
+	return err
+}
+
+// videos returns the versions the renditions play now.
+func (b *Broadcast) videos() []*framestore.Video {
+	videos := make([]*framestore.Video, len(b.renditions))
+	for i, r := range b.renditions {
+		videos[i] = r.video.Load()
+	}
+	return videos
+}
+
+// attachAdaptive selects layers by the bitrates of the versions playing
+// when the estimate changes, so selection follows reloads.
+func (b *Broadcast) attachAdaptive(session *Session, estimator cc.BandwidthEstimator) error {
+	track, err := newRTPTrack(b.renditions[0].video.Load().Header)
+	if err != nil {
+		return err
+	}
+	sender, feedback, err := addTrack(session, track)
+	if err != nil {
+		return err
+	}
+
+	layer := selectLayer(b.videos(), estimator.GetTargetBitrate())
+	v := &viewer{
+		track:      track,
+		renditions: b.renditions,
+		done:       session.Done(),
+		log:        trackLogger(session, sender, feedback),
+		current:    layer,
+		pending:    layer,
+	}
+	b.renditions[layer].join(v)
+	estimator.OnTargetBitrateChange(func(bitrate int) {
+		if v.ended() {
+			return
+		}
+		layers := b.videos()
+		target := selectLayer(layers, bitrate)
+
+		v.mu.Lock()
+		if target == v.pending {
+			v.mu.Unlock()
+			return
+		}
+		current := v.current
+		v.pending = target
+		v.mu.Unlock()
+
+		v.log.Info("select layer", attr.Switch(layers[current].Path, layers[target].Path), attr.Bitrate(bitrate))
+		if target != current {
+			b.renditions[target].enqueue(v)
+		}
+	})
+
+	return nil
+}
+
+func (v *viewer) ended() bool {
+	select {
+	case <-v.done:
+		return true
+	default:
+		return false
+	}
+}
+
+// write sends a packet of rendition r on the viewer track. It returns false
+// once the viewer left r, for r to drop it.
+func (v *viewer) write(r *rendition, packet *rtp.Packet, now time.Time) bool {
+	v.mu.Lock()
+	defer v.mu.Unlock()
+	if v.current != r.layer {
+		return false
+	}
+
+	// The packet is shared by the viewers of r; only the header is
+	// rewritten.
+	rewritten := *packet
+	v.rewrite.apply(&rewritten.Header, now)
+	if err := v.track.WriteRTP(&rewritten); err != nil {
+		writeErrors.With(r.video.Load().Path).Inc()
+	}
+	return true
+}
+
+func (r *rendition) enqueue(v *viewer) {
+	r.mu.Lock()
+	r.waiting = append(r.waiting, v)
+	r.mu.Unlock()
+}
+
+// join adds a viewer to the ones sent the packets of the rendition.
+func (r *rendition) join(v *viewer) {
+	r.mu.Lock()
+	if !slices.Contains(r.viewers, v) {
+		r.viewers = append(r.viewers, v)
+	}
+	r.mu.Unlock()
+}
+
+// switchWaiting moves viewers waiting for this rendition onto it. It runs
+// right before a keyframe so they start with a decodable frame; their
+// sequence numbers and timestamps continue from the previous rendition.
+// Viewers whose session ended are dropped.
+func (r *rendition) switchWaiting() {
+	r.mu.Lock()
+	waiting := r.waiting
+	r.waiting = nil
+	r.mu.Unlock()
+
+	for _, v := range waiting {
+		if v.ended() {
+			continue
+		}
+		v.mu.Lock()
+		switched := v.pending == r.layer && v.current != r.layer
+		if switched {
+			v.log.Info("switch layer", attr.Switch(v.renditions[v.current].video.Load().Path, r.video.Load().Path))
+			v.current = r.layer
+			v.rewrite.rebase(rtpcache.ClockRate)
+		}
+		v.mu.Unlock()
+		if switched {
+			r.join(v)
+		}
+	}
+}
+
+// send writes the packets of a frame to the shared track and to the viewers
+// on the rendition, and drops viewers that left it. It returns the first
+// error of the shared track.
+func (r *rendition) send(packets []*rtp.Packet) error {
+	r.mu.Lock()
+	viewers := r.viewers
+	r.mu.Unlock()
+
+	var err error
+	var left []*viewer
+	now := time.Now()
+	for _, packet := range packets {
+		if writeErr := r.track.WriteRTP(packet); writeErr != nil && err == nil {
+			err = writeErr
+		}
+		for _, v := range viewers {
+			if !slices.Contains(left, v) && (v.ended() || !v.write(r, packet, now)) {
+				left = append(left, v)
+			}
+		}
+	}
+
+	if len(left) > 0 {
+		r.mu.Lock()
+		r.viewers = slices.DeleteFunc(r.viewers, func(v *viewer) bool { return slices.Contains(left, v) })
+		r.mu.Unlock()
+	}
+	return err
+}
+
+// produce writes the video to the track in a loop that restarts at the first
+// keyframe. The packetizer keeps timestamps increasing. A track without bound
+// peer connections drops packets, so the timeline keeps going with no viewers.
+// At keyframes the producer moves to a reloaded version of its video. It
+// returns once done is closed.
+func (r *rendition) produce(playback Playback, done <-chan struct{}) {
+	video := r.video.Load()
+	if video.FrameCount() == 0 {
+		slog.Error("empty broadcast video", attr.Path(video.Path))
+		return
+	}
+
+	latest := newVersions(playback.store)
+	if video = latest.acquire(video); video == nil {
+		slog.Error("broadcast video removed", attr.Path(r.video.Load().Path))
+		return
+	}
+	r.video.Store(video)
+	defer func() { video.Release() }()
+
+	clock := playback.scheduler.newClock()
+	metrics := newRenditionMetrics(video)
+	var position time.Duration
+	for i := 0; ; i = video.Next(i) {
+		if !clock.Wait(position, done) {
+			return
+		}
+		if video.FrameInfo(i).Keyframe {
+			if next, j := latest.follow(video, i); next != video {
+				video, i = next, j
+				r.video.Store(video)
+			}
+			r.switchWaiting()
+		}
+
+		frame := video.Frame(i)
+		start := time.Now()
+		samples := uint32(video.FrameDuration(i).Seconds() * rtpcache.ClockRate)
+		err := r.send(r.packetizer.Packetize(frame, samples))
+		metrics.written(len(frame), start, err)
+		if err != nil {
+			slog.Error("write sample", attr.Path(video.Path), attr.Error(err))
+		}
+		position += video.FrameDuration(i)
+	}
+}
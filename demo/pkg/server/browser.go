@@ -0,0 +1,81 @@
+package server
+
+import (
+	"bwe/demo/pkg/attr"
+	"bwe/demo/pkg/client"
+	"bwe/demo/pkg/report"
+	"encoding/json"
+	"fmt"
+	"log/slog"
+	"path/filepath"
+	"strconv"
+)
+
+// browserReport is the report of the stats a browser session uploads. It
+// is opened on the first upload, so sessions of other clients leave no
+// file, and written by its own goroutine, so uploads never wait for disk.
+type browserReport struct {
+	config  BrowserConfig
+	session int
+
+	queue  *report.Queue
+	failed bool
+}
+
+// add queues an uploaded batch, stamping it with the session. A batch that
+// does not parse or does not fit into the queue is dropped.
+func (r *browserReport) add(batch json.RawMessage) {
+	if r.failed {
+		return
+	}
+
+	var records []client.StreamStats
+	if err := json.Unmarshal(batch, &records); err != nil {
+		browserStatsDropped.Inc()
+		slog.Warn("parse browser stats", attr.Session(r.session), attr.Error(err))
+		return
+	}
+
+	if r.queue == nil {
+		queue, err := r.open()
+		if err != nil {
+			r.failed = true
+			slog.Error("open browser report", attr.Session(r.session), attr.Error(err))
+			return
+		}
+		r.queue = queue
+	}
+
+	for _, record := range records {
+		record.Session = r.session
+		if r.queue.Push(record) {
+			browserStats.Inc()
+		} else {
+			browserStatsDropped.Inc()
+		}
+	}
+}
+
+func (r *browserReport) open() (*report.Queue, error) {
+	extension := "log"
+	if r.config.Format == report.FormatBinary {
+		extension = "bin"
+	}
+	path := filepath.Join(r.config.Dir, fmt.Sprintf("browser-%d.%s", r.session, extension))
+
+	meta := map[string]string{"source": "browser", "session": strconv.Itoa(r.session)}
+	writer, err := report.NewWriter(path, r.config.Format, client.StreamStatsSchema, meta, r.config.FlushInterval)
+	if err != nil {
+		return nil, err
+	}
+	return report.NewQueue(writer, r.config.QueueSize), nil
+}
+
+func (r *browserReport) close() {
+	if r.queue == nil {
+		return
+	}
+	if err := r.queue.Close(); err != nil {
+		slog.Error("close browser report", attr.Session(r.session), attr.Error(err))
+	}
+}
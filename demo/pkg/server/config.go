@@ -0,0 +1,162 @@
+package server
+
+import (
+	"bwe/demo/pkg/logging"
+	"bwe/demo/pkg/pacer"
+	"bwe/demo/pkg/pipeline"
+	"bwe/demo/pkg/probe"
+	"bwe/demo/pkg/report"
+	"fmt"
+	"os"
+	"time"
+
+	"gopkg.in/yaml.v3"
+)
+
+// Config is the server config. Loop plays per-session tracks in a loop
+// instead of ending them at the end of the video; broadcast always loops.
+// Pipeline configures the interceptors and is recorded in the report header.
+// Log configures the logging backend, which rate limits the messages
+// sessions repeat. AdminAddr is the listen address of the endpoints for
+// operators and edges, /reload, /sessions and /relay, which stay off the
+// public Port; an empty one disables them.
+type Config struct {
+	Port       int             `yaml:"port"`
+	AdminAddr  string          `yaml:"admin_addr"`
+	VideoPaths []string        `yaml:"video_paths"`
+	IceServer  string          `yaml:"ice_server"`
+	Broadcast  bool            `yaml:"broadcast"`
+	Loop       bool            `yaml:"loop"`
+	Recovery   RecoveryConfig  `yaml:"recovery"`
+	BWE        BWEConfig       `yaml:"bwe"`
+	Pacer      PacerConfig     `yaml:"pacer"`
+	Transport  TransportConfig `yaml:"transport"`
+	Report     ReportConfig    `yaml:"report"`
+	Browser    BrowserConfig   `yaml:"browser_report"`
+	Admission  AdmissionConfig `yaml:"admission"`
+	Relay      RelayConfig     `yaml:"relay"`
+	RTPCache   RTPCacheConfig  `yaml:"rtp_cache"`
+	Pipeline   pipeline.Config `yaml:"pipeline"`
+	Log        logging.Config  `yaml:"log"`
+}
+
+// BWEConfig enables send-side bandwidth estimation on TWCC feedback. Each
+// session then receives only the rendition that fits the estimate.
+type BWEConfig struct {
+	Enabled        bool        `yaml:"enabled"`
+	InitialBitrate int         `yaml:"initial_bitrate"`
+	MinBitrate     int         `yaml:"min_bitrate"`
+	MaxBitrate     int         `yaml:"max_bitrate"`
+	Probe          ProbeConfig `yaml:"probe"`
+}
+
+// ProbeConfig sends probe clusters of padding above the estimate once ICE
+// connects and then periodically, so the estimate ramps up faster than the
+// media. Clusters are capped at the maximum bitrate of the estimator.
+type ProbeConfig struct {
+	Enabled      bool `yaml:"enabled"`
+	probe.Config `yaml:",inline"`
+}
+
+// PacerConfig puts a leaky bucket between the tracks and the network. With
+// bandwidth estimation the estimate drives the rate, otherwise it stays at
+// the initial bitrate.
+type PacerConfig struct {
+	Enabled      bool `yaml:"enabled"`
+	pacer.Config `yaml:",inline"`
+}
+
+// TransportConfig lets peer connections share ICE sockets and DTLS state.
+// Zero ports keep the default of ephemeral sockets per connection.
+type TransportConfig struct {
+	UDPPort           int      `yaml:"udp_port"`
+	TCPPort           int      `yaml:"tcp_port"`
+	SharedCertificate bool     `yaml:"shared_certificate"`
+	SRTPProfiles      []string `yaml:"srtp_profiles"`
+}
+
+// ReportConfig writes per-sender stats and RTCP feedback every Interval.
+// An empty File disables the report and the stats interceptor.
+type ReportConfig struct {
+	File          string        `yaml:"file"`
+	Format        report.Format `yaml:"format"`
+	Interval      time.Duration `yaml:"interval"`
+	FlushInterval time.Duration `yaml:"flush_interval"`
+	QueueSize     int           `yaml:"queue_size"`
+}
+
+// BrowserConfig asks browsers to upload their getStats every Interval and
+// writes them, in the layout of the client report, to a file per session in
+// Dir. An empty Dir disables the uploads.
+type BrowserConfig struct {
+	Dir           string        `yaml:"dir"`
+	Format        report.Format `yaml:"format"`
+	Interval      time.Duration `yaml:"interval"`
+	FlushInterval time.Duration `yaml:"flush_interval"`
+	QueueSize     int           `yaml:"queue_size"`
+}
+
+// AdmissionConfig limits the sessions /watch takes. Zero values disable a
+// limit. Refused clients get a signaling error instead of an offer.
+type AdmissionConfig struct {
+	MaxSessions int `yaml:"max_sessions"`
+	// MaxEgressBitrate bounds the summed video bitrate of live sessions. On
+	// edges a session counts the measured bitrate of the upstream tracks,
+	// and sessions are refused until it is measured.
+	MaxEgressBitrate int `yaml:"max_egress_bitrate"`
+	// Degrade admits sessions over the bitrate budget on the lowest
+	// rendition only, if that still fits, instead of refusing them.
+	Degrade bool `yaml:"degrade"`
+	// New sessions are refused while send loops missed more than
+	// MaxTickerOverruns frame ticks in the last ShedInterval, or pacers hold
+	// more than MaxPacerQueue packets in total.
+	ShedInterval      time.Duration `yaml:"shed_interval"`
+	MaxTickerOverruns int           `yaml:"max_ticker_overruns"`
+	MaxPacerQueue     int           `yaml:"max_pacer_queue"`
+}
+
+// RecoveryConfig answers PLI and FIR on per-session tracks by moving the
+// session to the nearest keyframe of its video, at most once per
+// MinInterval. Broadcast tracks are shared and wait for the next keyframe.
+type RecoveryConfig struct {
+	Enabled     bool          `yaml:"enabled"`
+	MinInterval time.Duration `yaml:"min_interval"`
+}
+
+// RTPCacheConfig packetizes each video once at startup into payloads of MTU
+// bytes with the RTP header. Per-session tracks then send the cached
+// payloads instead of running the payloader on every frame. Broadcast tracks
+// packetize once per frame for all viewers already and do not use it.
+type RTPCacheConfig struct {
+	Enabled bool `yaml:"enabled"`
+	MTU     int  `yaml:"mtu"`
+}
+
+const (
+	RoleOrigin = "origin"
+	RoleEdge   = "edge"
+)
+
+// RelayConfig splits the server into an origin and edges. The origin reads
+// and packetizes each video once in broadcast mode and serves every
+// rendition on /relay of its admin address. An edge subscribes to Origin,
+// the websocket URL of that endpoint, over one peer connection and fans the RTP out to its own
+// viewers. An empty Role serves viewers directly.
+type RelayConfig struct {
+	Role   string `yaml:"role"`
+	Origin string `yaml:"origin"`
+}
+
+func LoadConfig(path string) (Config, error) {
+	configBytes, err := os.ReadFile(path)
+	if err != nil {
+		return Config{}, fmt.Errorf("read file: %w", err)
+	}
+	var config Config
+	err = yaml.Unmarshal(configBytes, &config)
+	if err != nil {
+		return Config{}, fmt.Errorf("yaml unmarshal: %w", err)
+	}
+
+	return config, nil
+}
@@ -0,0 +1,106 @@
+package server
+
+import (
+	"slices"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"github.com/pion/rtcp"
+	"github.com/pion/webrtc/v4"
+)
+
+// senderFeedback counts the RTCP feedback addressed to one RTP sender. Loss,
+// jitter and RTT from receiver reports come from the stats interceptor; this
+// covers what it does not track. TWCC is transport-wide and lands on the
+// sender whose SSRC the feedback carries.
+type senderFeedback struct {
+	ssrc uint32
+
+	receiverReports    atomic.Uint32
+	rembBitrate        atomic.Uint64
+	twccFeedback       atomic.Uint32
+	twccPacketStatuses atomic.Uint64
+	nackedPackets      atomic.Uint32
+
+	// keyframeRequests holds the arrival of the oldest PLI or FIR the send
+	// loop has not seen yet. Later requests coalesce into it.
+	keyframeRequests chan time.Time
+}
+
+// feedbackSet holds the feedback of every sender of a peer connection.
+type feedbackSet struct {
+	mu      sync.Mutex
+	senders []*senderFeedback
+}
+
+func (s *feedbackSet) add(ssrc webrtc.SSRC) *senderFeedback {
+	feedback := &senderFeedback{ssrc: uint32(ssrc), keyframeRequests: make(chan time.Time, 1)}
+
+	s.mu.Lock()
+	s.senders = append(s.senders, feedback)
+	s.mu.Unlock()
+
+	return feedback
+}
+
+func (s *feedbackSet) remove(feedback *senderFeedback) {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	s.senders = slices.DeleteFunc(s.senders, func(f *senderFeedback) bool { return f == feedback })
+}
+
+func (s *feedbackSet) snapshot() []*senderFeedback {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+
+	return slices.Clone(s.senders)
+}
+
+func senderSSRC(sender *webrtc.RTPSender) webrtc.SSRC {
+	encodings := sender.GetParameters().Encodings
+	if len(encodings) == 0 {
+		return 0
+	}
+	return encodings[0].SSRC
+}
+
+func (f *senderFeedback) requestKeyframe() {
+	select {
+	case f.keyframeRequests <- time.Now():
+	default:
+	}
+}
+
+// readFeedback drains RTCP from the sender until it is stopped. Reading is
+// required either way, interceptors only see packets that are read.
+func readFeedback(sender *webrtc.RTPSender, feedback *senderFeedback) {
+	for {
+		packets, _, err := sender.ReadRTCP()
+		if err != nil {
+			return
+		}
+
+		for _, packet := range packets {
+			switch packet := packet.(type) {
+			case *rtcp.ReceiverReport:
+				feedback.receiverReports.Add(1)
+			case *rtcp.ReceiverEstimatedMaximumBitrate:
+				feedback.rembBitrate.Store(uint64(packet.Bitrate))
+			case *rtcp.TransportLayerCC:
+				feedback.twccFeedback.Add(1)
+				feedback.twccPacketStatuses.Add(uint64(packet.PacketStatusCount))
+			case *rtcp.TransportLayerNack:
+				for _, pair := range packet.Nacks {
+					feedback.nackedPackets.Add(uint32(len(pair.PacketList())))
+				}
+			case *rtcp.PictureLossIndication:
+				keyframeRequests.With("pli").Inc()
+				feedback.requestKeyframe()
+			case *rtcp.FullIntraRequest:
+				keyframeRequests.With("fir").Inc()
+				feedback.requestKeyframe()
+			}
+		}
+	}
+}
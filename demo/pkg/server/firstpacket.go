@@ -0,0 +1,37 @@
+package server
+
+import (
+	"bwe/demo/pkg/pacer"
+	"sync"
+
+	"github.com/pion/interceptor"
+	"github.com/pion/rtp"
+)
+
+// firstPacketFactory builds interceptors that report when a peer connection
+// hands its first RTP packet to the transport. Probes carry no media and do
+// not count.
+type firstPacketFactory struct {
+	onNewPeerConnection func(sent <-chan struct{})
+}
+
+func (f *firstPacketFactory) NewInterceptor(_ string) (interceptor.Interceptor, error) {
+	i := &firstPacketInterceptor{sent: make(chan struct{})}
+	f.onNewPeerConnection(i.sent)
+	return i, nil
+}
+
+type firstPacketInterceptor struct {
+	interceptor.NoOp
+	once sync.Once
+	sent chan struct{}
+}
+
+func (i *firstPacketInterceptor) BindLocalStream(_ *interceptor.StreamInfo, writer interceptor.RTPWriter) interceptor.RTPWriter {
+	return interceptor.RTPWriterFunc(func(header *rtp.Header, payload []byte, attributes interceptor.Attributes) (int, error) {
+		if attributes.Get(pacer.ProbeAttributesKey) == nil {
+			i.once.Do(func() { close(i.sent) })
+		}
+		return writer.Write(header, payload, attributes)
+	})
+}
@@ -0,0 +1,597 @@
+package server
+
+import (
+	"bwe/demo/pkg/attr"
+	"bwe/demo/pkg/framestore"
+	"bwe/demo/pkg/rtpcache"
+	"bwe/demo/pkg/signal"
+	"context"
+	"errors"
+	"fmt"
+	"log/slog"
+	"os"
+	"slices"
+	"sync/atomic"
+	"time"
+
+	"github.com/pion/transport/v3"
+	"github.com/pion/webrtc/v4"
+	"github.com/pion/webrtc/v4/pkg/media/ivfreader"
+	"golang.org/x/net/websocket"
+)
+
+type Handler struct {
+	PeerConnectionFactory PeerConnectionFactory
+	FrameStore            *framestore.Store
+	Broadcast             *Broadcast
+	Report                *Report
+	ReportInterval        time.Duration
+	Sessions              *Sessions
+	// Upstream is set on edges, which relay the tracks of the origin
+	// instead of reading videos.
+	Upstream *Upstream
+	// Packets is the RTP cache, nil unless enabled.
+	Packets *rtpcache.Store
+	// Playback applies to per-session tracks.
+	Playback Playback
+
+	admission    *admission
+	relayFactory PeerConnectionFactory
+	probing      probing
+	// catalog holds the video paths, which Reload replaces.
+	catalog *catalog
+	// browser is the config of the stats uploaded by viewers, disabled
+	// with an empty Dir.
+	browser BrowserConfig
+}
+
+var sessionIDs atomic.Int64
+
+// NewHandler loads the videos and sets up the state shared by sessions. A
+// nil network uses the host's.
+func NewHandler(config Config, network transport.Net) (Handler, error) {
+	pcFactory, err := newPeerConnectionFactory(config, network)
+	if err != nil {
+		return Handler{}, fmt.Errorf("new peer connection factory: %w", err)
+	}
+
+	frameStore := framestore.New()
+	var packets *rtpcache.Store
+	if config.RTPCache.Enabled {
+		packets = rtpcache.New(config.RTPCache.MTU)
+		frameStore.OnRelease(packets.Remove)
+	}
+
+	videos := make([]*framestore.Video, 0, len(config.VideoPaths))
+	for _, videoPath := range config.VideoPaths {
+		video, err := frameStore.Get(videoPath)
+		if err != nil {
+			slog.Error("load video", attr.Path(videoPath), attr.Error(err))
+			continue
+		}
+		videos = append(videos, video)
+	}
+
+	handler := Handler{
+		PeerConnectionFactory: pcFactory,
+		FrameStore:            frameStore,
+		Packets:               packets,
+		Playback:              Playback{Loop: config.Loop, Recovery: config.Recovery, scheduler: newFrameScheduler(), store: frameStore},
+		Sessions:              NewSessions(),
+		admission:             newAdmission(config.Admission, videos, config.BWE.Enabled),
+		probing:               probing{config: config.BWE.Probe.WithDefaults(), maxBitrate: config.BWE.MaxBitrate},
+		browser:               config.Browser,
+		catalog:               newCatalog(config.VideoPaths),
+	}
+
+	if handler.Packets != nil {
+		for _, video := range videos {
+			_, err = handler.Packets.Get(video)
+			if err != nil {
+				return Handler{}, fmt.Errorf("packetize %s: %w", video.Path, err)
+			}
+		}
+	}
+
+	if config.Broadcast {
+		if config.BWE.Enabled {
+			videos, err = newLayers(videos)
+			if err != nil {
+				return Handler{}, fmt.Errorf("new layers: %w", err)
+			}
+		}
+
+		handler.Broadcast, err = newBroadcast(videos, handler.Playback)
+		if err != nil {
+			return Handler{}, fmt.Errorf("new broadcast: %w", err)
+		}
+	}
+
+	if config.Relay.Role != "" {
+		handler.relayFactory, err = newPeerConnectionFactory(relayConfig(config), network)
+		if err != nil {
+			return Handler{}, fmt.Errorf("new relay peer connection factory: %w", err)
+		}
+	}
+
+	switch config.Relay.Role {
+	case "":
+	case RoleOrigin:
+		if handler.Broadcast == nil {
+			return Handler{}, errors.New("origin requires broadcast")
+		}
+	case RoleEdge:
+		handler.admission.relay()
+		handler.Upstream = newUpstream(config.Relay.Origin, handler.relayFactory, handler.admission.setRelayBitrate)
+	default:
+		return Handler{}, fmt.Errorf("unknown relay role %s", config.Relay.Role)
+	}
+
+	if config.Report.File != "" {
+		handler.Report, err = newReport(config.Report, config.Pipeline.Meta())
+		if err != nil {
+			return Handler{}, fmt.Errorf("new report: %w", err)
+		}
+		handler.ReportInterval = config.Report.Interval
+	}
+
+	if config.Browser.Dir != "" {
+		if err = os.MkdirAll(config.Browser.Dir, 0o755); err != nil {
+			return Handler{}, fmt.Errorf("create browser report dir: %w", err)
+		}
+	}
+
+	handler.admission.startShedding(handler.Sessions)
+	if handler.Upstream != nil {
+		handler.Upstream.start()
+	}
+
+	return handler, nil
+}
+
+// Close cancels the live sessions, stops the broadcast and flushes the
+// sender report.
+func (h Handler) Close() error {
+	h.Sessions.Close()
+	h.admission.close()
+	if h.Broadcast != nil {
+		h.Broadcast.close()
+	}
+	h.Playback.scheduler.close()
+	if h.Upstream != nil {
+		h.Upstream.close()
+	}
+
+	if h.Report == nil {
+		return nil
+	}
+	return h.Report.Close()
+}
+
+// Watch runs a session on the websocket. The session ends when the websocket
+// closes or the peer connection fails, and Watch returns once it is torn down.
+func (h Handler) Watch(ws *websocket.Conn) {
+	signalConn := signal.NewConn(ws)
+
+	grant, err := h.admission.admit()
+	if err != nil {
+		sessionsRefused.With(err.Error()).Inc()
+		slog.Warn("refuse session", attr.Error(err))
+		if err := signalConn.SendError(err.Error()); err != nil {
+			slog.Error("send refusal", attr.Error(err))
+		}
+		return
+	}
+	defer h.admission.release(grant)
+
+	mode := modeFull
+	if grant.lowest {
+		sessionsDegraded.Inc()
+		mode = modeLowest
+	}
+
+	h.serve(ws, signalConn, h.PeerConnectionFactory, mode)
+}
+
+// Relay runs a session for an edge on the origin. Edges are trusted and get
+// every rendition, so admission control does not apply.
+func (h Handler) Relay(ws *websocket.Conn) {
+	h.serve(ws, signal.NewConn(ws), h.relayFactory, modeRelay)
+}
+
+func (h Handler) serve(ws *websocket.Conn, signalConn *signal.Conn, pcFactory PeerConnectionFactory, mode sessionMode) {
+	pc, err := pcFactory.New()
+	if err != nil {
+		slog.Error("new peer connection", attr.Error(err))
+		return
+	}
+
+	session := newSession(pc, mode)
+	h.Sessions.add(session)
+	defer func() {
+		session.close()
+		h.Sessions.remove(session)
+	}()
+
+	// Closing the websocket unblocks Receive when the peer connection fails.
+	session.Go(func() {
+		<-session.Done()
+		_ = ws.Close()
+	})
+
+	if h.Report != nil && pc.Stats != nil {
+		session.Go(func() { h.sampleSenderStats(session) })
+	}
+
+	// Edges do not upload stats; their viewers do on their own sessions.
+	var statsInterval time.Duration
+	var browser *browserReport
+	if h.browser.Dir != "" && mode != modeRelay {
+		statsInterval = h.browser.Interval
+		browser = &browserReport{config: h.browser, session: session.ID}
+		defer browser.close()
+	}
+
+	setup := signal.NewSetupTimer(session.log)
+	session.Go(func() {
+		select {
+		case <-pc.FirstPacket:
+			setup.Log("first_frame")
+		case <-session.Done():
+		}
+	})
+
+	err = h.addTracks(session)
+	if err != nil {
+		slog.Error("add tracks", attr.Error(err))
+		return
+	}
+	h.probing.start(session)
+
+	pc.OnSignalingStateChange(func(state webrtc.SignalingState) {
+		slog.Info("signaling state changed", attr.State(state))
+	})
+
+	pc.OnICEGatheringStateChange(func(state webrtc.ICEGatheringState) {
+		slog.Info("ice gathering state changed", attr.State(state))
+	})
+
+	pc.OnICEConnectionStateChange(func(state webrtc.ICEConnectionState) {
+		slog.Info("ice connection state changed", attr.State(state))
+		if state == webrtc.ICEConnectionStateConnected {
+			setup.Mark("ice_connected")
+			session.setConnected()
+		}
+	})
+
+	pc.OnConnectionStateChange(func(state webrtc.PeerConnectionState) {
+		slog.Info("connection state changed", attr.State(state))
+		connectionStates.With(state.String()).Inc()
+		session.setState(state)
+	})
+
+	pc.OnICECandidate(func(candidate *webrtc.ICECandidate) {
+		if err := signalConn.SendCandidate(candidate); err != nil {
+			slog.Error("send local candidate", attr.Error(err))
+		}
+	})
+
+	offer, err := pc.CreateOffer(nil)
+	if err != nil {
+		slog.Error("create offer", attr.Error(err))
+		return
+	}
+
+	if err = pc.SetLocalDescription(offer); err != nil {
+		slog.Error("set local description", attr.Error(err))
+		return
+	}
+
+	err = signalConn.SendOffer(offer, statsInterval)
+	if err != nil {
+		slog.Error("send local description", attr.Error(err))
+		return
+	}
+	setup.Mark("offer")
+
+	negotiation := negotiator{h: h, session: session, conn: signalConn}
+	for {
+		message, err := signalConn.Receive()
+		if err != nil {
+			if session.ctx.Err() != nil {
+				slog.Info("session ended", attr.Session(session.ID))
+			} else {
+				slog.Error("wait socket closed", attr.Error(err))
+			}
+			return
+		}
+
+		switch message.Type {
+		case signal.TypeAnswer:
+			initial := pc.CurrentRemoteDescription() == nil
+			err = pc.SetRemoteDescription(message.SessionDescription())
+			if err != nil {
+				slog.Error("set remote description", attr.Error(err))
+				return
+			}
+			if initial {
+				setup.Mark("answer")
+			}
+			negotiation.answered()
+		case signal.TypeRenegotiate:
+			negotiation.request(message)
+		case signal.TypeStats:
+			if browser == nil {
+				slog.Warn("unrequested stats", attr.Session(session.ID))
+				continue
+			}
+			browser.add(message.Stats)
+		case signal.TypeCandidate:
+			if message.Candidate == nil {
+				continue
+			}
+			err = pc.AddICECandidate(*message.Candidate)
+			if err != nil {
+				slog.Error("add remote candidate", attr.Error(err))
+			}
+		default:
+			slog.Error("unexpected signaling message", attr.Type(message.Type))
+		}
+	}
+}
+
+// sampleSenderStats pushes the stats of every sender of the session to the
+// report until the session is done.
+func (h Handler) sampleSenderStats(session *Session) {
+	pc := session.pc
+	ticker := time.NewTicker(h.ReportInterval)
+	defer ticker.Stop()
+	for {
+		select {
+		case <-session.Done():
+			return
+		case <-ticker.C:
+		}
+
+		dropped := 0
+		for _, feedback := range pc.Feedback.snapshot() {
+			rawStats := pc.Stats.Get(feedback.ssrc)
+			if rawStats == nil {
+				continue
+			}
+			if !h.Report.Push(newSenderStats(session.ID, feedback, rawStats)) {
+				dropped++
+			}
+		}
+		if dropped > 0 {
+			slog.Warn("report queue full", attr.Session(session.ID), slog.Int("dropped", dropped))
+		}
+	}
+}
+
+// addTracks attaches the session to the broadcast or starts its own tracks.
+// With bandwidth estimation a single track follows the estimate. Sessions
+// admitted degraded get only the cheapest video. Viewers of an edge get the
+// relayed tracks as they are, or the cheapest of them, and their keyframe
+// requests go to the origin.
+func (h Handler) addTracks(session *Session) error {
+	if h.Upstream != nil {
+		tracks, ok := h.Upstream.Tracks(session.Done())
+		if !ok {
+			return errors.New("upstream not ready")
+		}
+		if session.mode == modeLowest && len(tracks) > 0 {
+			tracks = []*relayTrack{lowestTrack(tracks)}
+		}
+		for _, track := range tracks {
+			_, feedback, err := addTrack(session, track.local)
+			if err != nil {
+				return err
+			}
+			track := track
+			session.Go(func() { h.Upstream.forwardKeyframes(track, feedback, session.Done()) })
+		}
+		return nil
+	}
+
+	if h.Broadcast != nil {
+		switch session.mode {
+		case modeLowest:
+			return h.Broadcast.AttachLowest(session)
+		case modeRelay:
+			return h.Broadcast.AttachAll(session)
+		}
+		return h.Broadcast.Attach(session)
+	}
+
+	// The versions are acquired after latest is created, so the loops see
+	// every version published since.
+	latest := newVersions(h.FrameStore)
+	videos := h.catalog.acquire(h.FrameStore)
+
+	if session.mode == modeLowest && len(videos) > 0 {
+		lowest := lowestVideo(videos)
+		video := videos[lowest]
+		releaseAll(slices.Delete(videos, lowest, lowest+1))
+		_, err := h.startVideoTrack(session, video, latest)
+		return err
+	}
+
+	if session.pc.Estimator != nil {
+		layers, err := newLayers(videos)
+		if err != nil {
+			releaseAll(videos)
+			return fmt.Errorf("new layers: %w", err)
+		}
+
+		videoTrack, err := h.newTrack(layers...)
+		if err != nil {
+			releaseAll(layers)
+			return err
+		}
+		return startAdaptiveTrack(session, videoTrack, layers, latest, h.Playback)
+	}
+
+	// Only sessions sent every video on tracks of their own can change the
+	// videos on renegotiation.
+	session.selectable = session.mode == modeFull
+	for _, video := range videos {
+		track, err := h.startVideoTrack(session, video, latest.fork())
+		if err != nil {
+			slog.Error("start track", attr.Error(err))
+			continue
+		}
+		session.tracks = append(session.tracks, track)
+	}
+
+	return nil
+}
+
+// startVideoTrack adds a track of its own for the video to the session. It
+// takes over the reference to video, which was acquired after latest was
+// created, so a concurrent reload cannot free it.
+func (h Handler) startVideoTrack(session *Session, video *framestore.Video, latest *versions) (*sessionTrack, error) {
+	videoTrack, err := h.newTrack(video)
+	if err != nil {
+		video.Release()
+		return nil, err
+	}
+	return startTrack(session, videoTrack, video, latest, h.Playback)
+}
+
+// startTrack sends the video on the track until the session ends or the
+// track is stopped. It takes over the reference to video, which latest was
+// created before.
+func startTrack(session *Session, videoTrack frameTrack, video *framestore.Video, latest *versions, playback Playback) (*sessionTrack, error) {
+	sender, feedback, err := addTrack(session, videoTrack)
+	if err != nil {
+		video.Release()
+		return nil, err
+	}
+
+	ctx, cancel := context.WithCancel(session.ctx)
+	track := &sessionTrack{video: video, sender: sender, feedback: feedback, cancel: cancel}
+
+	session.Go(func() {
+		defer cancel()
+		// The loop moves video to new versions, releasing the old ones.
+		defer func() { video.Release() }()
+		if !session.waitConnected() {
+			return
+		}
+		log := trackLogger(session, sender, feedback).With(attr.Path(video.Path))
+		clock := playback.scheduler.newClock()
+		metrics := newRenditionMetrics(video)
+		recovery := playback.newRecovery(feedback)
+		var position time.Duration
+		for i := 0; ; i = advance(video, i, playback.Loop) {
+			if i == video.FrameCount() {
+				log.Info("track over")
+				return
+			}
+			if !clock.Wait(position, ctx.Done()) {
+				return
+			}
+			i = recovery.next(video, i)
+			if video.FrameInfo(i).Keyframe {
+				video, i = latest.follow(video, i)
+			}
+
+			start := time.Now()
+			size, err := videoTrack.writeFrame(video, i, position)
+			metrics.written(size, start, err)
+			if err != nil {
+				log.Error("write sample", attr.Error(err))
+				return
+			}
+			position += video.FrameDuration(i)
+		}
+	})
+
+	return track, nil
+}
+
+// trackLogger returns the logger of a send loop, carrying the session, the
+// SSRC and, once negotiated, the mid of the sender.
+func trackLogger(session *Session, sender *webrtc.RTPSender, feedback *senderFeedback) *slog.Logger {
+	log := session.log.With(attr.SSRC(webrtc.SSRC(feedback.ssrc)))
+	for _, transceiver := range session.pc.GetTransceivers() {
+		if transceiver.Sender() == sender {
+			return log.With(attr.Mid(transceiver.Mid()))
+		}
+	}
+	return log
+}
+
+func newVideoTrack(header ivfreader.IVFFileHeader) (*webrtc.TrackLocalStaticSample, error) {
+	trackCodec, err := mimeType(header.FourCC)
+	if err != nil {
+		return nil, err
+	}
+
+	videoTrack, err := webrtc.NewTrackLocalStaticSample(webrtc.RTPCodecCapability{MimeType: trackCodec}, "video", "pion")
+	if err != nil {
+		return nil, fmt.Errorf("new track local: %w", err)
+	}
+
+	return videoTrack, nil
+}
+
+func newRTPTrack(header ivfreader.IVFFileHeader) (*webrtc.TrackLocalStaticRTP, error) {
+	trackCodec, err := mimeType(header.FourCC)
+	if err != nil {
+		return nil, err
+	}
+
+	videoTrack, err := webrtc.NewTrackLocalStaticRTP(webrtc.RTPCodecCapability{MimeType: trackCodec}, "video", "pion")
+	if err != nil {
+		return nil, fmt.Errorf("new track local: %w", err)
+	}
+
+	return videoTrack, nil
+}
+
+func mimeType(fourCC string) (string, error) {
+	switch fourCC {
+	case "AV01":
+		return webrtc.MimeTypeAV1, nil
+	case "VP90":
+		return webrtc.MimeTypeVP9, nil
+	case "VP80":
+		return webrtc.MimeTypeVP8, nil
+	default:
+		return "", fmt.Errorf("unable to handle FourCC %s", fourCC)
+	}
+}
+
+func addTrack(session *Session, track webrtc.TrackLocal) (*webrtc.RTPSender, *senderFeedback, error) {
+	rtpSender, err := session.pc.AddTrack(track)
+	if err != nil {
+		return nil, nil, fmt.Errorf("add track: %w", err)
+	}
+
+	feedback := session.pc.Feedback.add(senderSSRC(rtpSender))
+	session.Go(func() { readFeedback(rtpSender, feedback) })
+
+	return rtpSender, feedback, nil
+}
+
+// Playback controls how per-session tracks walk their video.
+type Playback struct {
+	// Loop restarts at the first keyframe after the last frame.
+	Loop     bool
+	Recovery RecoveryConfig
+
+	scheduler *frameScheduler
+	// store has the current versions tracks move to at keyframes.
+	store *framestore.Store
+}
+
+// advance returns the frame after i. Past the last frame it loops back to the
+// first keyframe, or returns FrameCount without loop.
+func advance(video *framestore.Video, i int, loop bool) int {
+	if loop {
+		return video.Next(i)
+	}
+	return i + 1
+}
@@ -0,0 +1,146 @@
+package server
+
+import (
+	"bwe/demo/pkg/attr"
+	"bwe/demo/pkg/framestore"
+	"errors"
+	"fmt"
+	"slices"
+	"time"
+)
+
+// newLayers orders renditions by average bitrate so that layer 0 is the
+// cheapest. All layers are sent on one track and must share a codec.
+func newLayers(videos []*framestore.Video) ([]*framestore.Video, error) {
+	if len(videos) == 0 {
+		return nil, errors.New("no layers")
+	}
+
+	layers := slices.Clone(videos)
+	slices.SortStableFunc(layers, func(a, b *framestore.Video) int {
+		return a.Bitrate() - b.Bitrate()
+	})
+
+	for _, layer := range layers[1:] {
+		if layer.Header.FourCC != layers[0].Header.FourCC {
+			return nil, fmt.Errorf("layer %s has FourCC %s, want %s", layer.Path, layer.Header.FourCC, layers[0].Header.FourCC)
+		}
+	}
+
+	return layers, nil
+}
+
+// selectLayer returns the highest layer whose bitrate fits into the estimate,
+// falling back to the lowest one.
+func selectLayer(layers []*framestore.Video, estimate int) int {
+	selected := 0
+	for i, layer := range layers {
+		if layer.Bitrate() <= estimate {
+			selected = i
+		}
+	}
+
+	return selected
+}
+
+// lowestVideo returns the index of the video with the lowest bitrate.
+func lowestVideo(videos []*framestore.Video) int {
+	lowest := 0
+	for i, video := range videos {
+		if video.Bitrate() < videos[lowest].Bitrate() {
+			lowest = i
+		}
+	}
+	return lowest
+}
+
+// startAdaptiveTrack sends a single track that follows the bandwidth
+// estimate, switching between layers on keyframes. It takes over the
+// references to the layers, which latest was created before.
+func startAdaptiveTrack(session *Session, videoTrack frameTrack, layers []*framestore.Video, latest *versions, playback Playback) error {
+	sender, feedback, err := addTrack(session, videoTrack)
+	if err != nil {
+		releaseAll(layers)
+		return err
+	}
+
+	session.Go(func() {
+		// The loop moves layers to new versions, releasing the old ones.
+		defer releaseAll(layers)
+		if !session.waitConnected() {
+			return
+		}
+		log := trackLogger(session, sender, feedback)
+
+		clock := playback.scheduler.newClock()
+		layerMetrics := make([]renditionMetrics, len(layers))
+		for i, layer := range layers {
+			layerMetrics[i] = newRenditionMetrics(layer)
+		}
+		recovery := playback.newRecovery(feedback)
+		current, pending := 0, 0
+		var position time.Duration
+		for i := 0; ; i = advance(layers[current], i, playback.Loop) {
+			if i == layers[current].FrameCount() {
+				log.Info("track over", attr.Path(layers[current].Path))
+				return
+			}
+			if !clock.Wait(position, session.Done()) {
+				return
+			}
+
+			estimate := session.pc.Estimator.GetTargetBitrate()
+			target := selectLayer(layers, estimate)
+			if target != pending {
+				log.Info("select layer", attr.Switch(layers[current].Path, layers[target].Path), attr.Bitrate(estimate))
+				pending = target
+			}
+
+			// A keyframe jump lands on a keyframe of the target layer, so
+			// it doubles as a switch.
+			i = recovery.next(layers[target], i)
+			if target != current && i < layers[target].FrameCount() && layers[target].FrameInfo(i).Keyframe {
+				log.Info("switch layer", attr.Switch(layers[current].Path, layers[target].Path), attr.Bitrate(estimate))
+				current = target
+			}
+			if i < layers[current].FrameCount() && layers[current].FrameInfo(i).Keyframe && latest.changed() {
+				i = followLayers(latest, layers, current, i)
+			}
+
+			start := time.Now()
+			size, err := videoTrack.writeFrame(layers[current], i, position)
+			layerMetrics[current].written(size, start, err)
+			if err != nil {
+				log.Error("write sample", attr.Error(err))
+				return
+			}
+			position += layers[current].FrameDuration(i)
+		}
+	})
+
+	return nil
+}
+
+// followLayers moves the layers to their current versions at keyframe i of
+// the current layer and returns the frame to continue with. The layers are
+// frame aligned, so the frame of the current one applies to all.
+func followLayers(latest *versions, layers []*framestore.Video, current, i int) int {
+	for k, layer := range layers {
+		next := latest.next(layer)
+		if next == nil {
+			continue
+		}
+		if k == current {
+			i = next.Resume(layer, i)
+		}
+		layer.Release()
+		layers[k] = next
+	}
+	return i
+}
+
+func releaseAll(videos []*framestore.Video) {
+	for _, video := range videos {
+		video.Release()
+	}
+}
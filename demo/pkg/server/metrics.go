@@ -0,0 +1,89 @@
+package server
+
+import (
+	"bwe/demo/pkg/framestore"
+	"bwe/demo/pkg/metrics"
+	"runtime"
+	"time"
+)
+
+var (
+	// Metrics is served on /metrics.
+	Metrics = metrics.NewRegistry()
+
+	sessionsActive = Metrics.NewGauge("bwe_sessions_active", "Sessions with an open websocket.")
+	sessionsTotal  = Metrics.NewCounter("bwe_sessions_total", "Sessions started.")
+
+	sessionsRefused  = Metrics.NewCounterVec("bwe_sessions_refused_total", "Sessions refused by admission control.", "reason")
+	sessionsDegraded = Metrics.NewCounter("bwe_sessions_degraded_total", "Sessions admitted on the lowest rendition only.")
+	egressReserved   = Metrics.NewGauge("bwe_egress_reserved_bitrate", "Bitrate reserved by admitted sessions.")
+	overloadedGauge  = Metrics.NewGauge("bwe_overloaded", "Whether admission control sheds new sessions.")
+
+	connectionStates = Metrics.NewCounterVec("bwe_connection_state_changes_total", "Peer connection state transitions.", "state")
+
+	framesSent      = Metrics.NewCounterVec("bwe_frames_sent_total", "Frames written to tracks.", "rendition")
+	bytesSent       = Metrics.NewCounterVec("bwe_frame_bytes_sent_total", "Frame payload bytes written to tracks.", "rendition")
+	writeErrors     = Metrics.NewCounterVec("bwe_write_sample_errors_total", "Failed WriteSample calls.", "rendition")
+	writeSampleTime = Metrics.NewHistogramVec("bwe_write_sample_seconds", "WriteSample duration.", "rendition", metrics.ExponentialBuckets(0.0001, 2, 12))
+
+	upstreamConnected     = Metrics.NewGauge("bwe_upstream_connected", "Whether the edge is connected to the origin.")
+	relayedPackets        = Metrics.NewCounter("bwe_relayed_packets_total", "RTP packets relayed from the origin.")
+	relayWriteErrors      = Metrics.NewCounter("bwe_relay_write_errors_total", "Relayed packets that failed to reach at least one viewer.")
+	relayKeyframeRequests = Metrics.NewCounter("bwe_relay_keyframe_requests_total", "Keyframe requests of viewers forwarded to the origin.")
+
+	keyframeRequests = Metrics.NewCounterVec("bwe_keyframe_requests_total", "PLI and FIR received.", "type")
+	keyframeJumps    = Metrics.NewCounter("bwe_keyframe_jumps_total", "Session tracks moved to a keyframe on request.")
+	keyframeResponse = Metrics.NewHistogram("bwe_keyframe_response_seconds", "Time from a keyframe request to sending a keyframe.", metrics.ExponentialBuckets(0.005, 2, 10))
+
+	renegotiations        = Metrics.NewCounter("bwe_renegotiations_total", "Renegotiations of live sessions answered.")
+	renegotiationsRefused = Metrics.NewCounter("bwe_renegotiations_refused_total", "Renegotiation requests refused.")
+	renegotiationTime     = Metrics.NewHistogram("bwe_renegotiation_seconds", "Time from a renegotiation offer to its answer.", metrics.ExponentialBuckets(0.001, 2, 12))
+
+	probeClusters = Metrics.NewCounter("bwe_probe_clusters_total", "Bandwidth probe clusters sent.")
+	probeBytes    = Metrics.NewCounter("bwe_probe_bytes_total", "Bytes of padding sent in probe clusters.")
+
+	videoReloads  = Metrics.NewCounter("bwe_video_reloads_total", "Reloads of the configured videos.")
+	videoVersions = Metrics.NewCounter("bwe_video_versions_published_total", "New video versions published by reloads.")
+
+	browserStats        = Metrics.NewCounter("bwe_browser_stats_total", "Stats records uploaded by browsers and queued for their report.")
+	browserStatsDropped = Metrics.NewCounter("bwe_browser_stats_dropped_total", "Browser stats records dropped unparsed or on a full report queue.")
+
+	tickerOverruns = Metrics.NewCounter("bwe_ticker_overruns_total", "Frame ticks missed because a send loop fell behind.")
+	frameLateness  = Metrics.NewHistogram("bwe_frame_schedule_lateness_seconds", "Time from the presentation time of a frame to its send loop waking up.", metrics.ExponentialBuckets(0.0001, 2, 14))
+)
+
+func init() {
+	Metrics.NewGaugeFunc("bwe_goroutines", "Number of goroutines.", func() float64 {
+		return float64(runtime.NumGoroutine())
+	})
+}
+
+// renditionMetrics are the send counters of one video, looked up once per
+// track so the send path only does atomic adds.
+type renditionMetrics struct {
+	frames      *metrics.Counter
+	bytes       *metrics.Counter
+	errors      *metrics.Counter
+	writeSample *metrics.Histogram
+}
+
+func newRenditionMetrics(video *framestore.Video) renditionMetrics {
+	return renditionMetrics{
+		frames:      framesSent.With(video.Path),
+		bytes:       bytesSent.With(video.Path),
+		errors:      writeErrors.With(video.Path),
+		writeSample: writeSampleTime.With(video.Path),
+	}
+}
+
+// written records a WriteSample call of size bytes that started at start.
+func (m renditionMetrics) written(size int, start time.Time, err error) {
+	m.writeSample.Observe(time.Since(start).Seconds())
+	if err != nil {
+		m.errors.Inc()
+		return
+	}
+
+	m.frames.Inc()
+	m.bytes.Add(uint64(size))
+}
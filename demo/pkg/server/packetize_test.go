@@ -0,0 +1,96 @@
+package server
+
+import (
+	"bwe/demo/pkg/framestore"
+	"bwe/demo/pkg/ivftest"
+	"bwe/demo/pkg/rtpcache"
+	"testing"
+	"time"
+
+	"github.com/pion/interceptor"
+	"github.com/pion/rtp"
+	"github.com/pion/webrtc/v4"
+)
+
+// discardContext binds a track the way a sender does, to a stream that
+// discards the packets. It has the methods of every pion release's
+// TrackLocalContext.
+type discardContext struct {
+	codec webrtc.RTPCodecParameters
+}
+
+func (c discardContext) CodecParameters() []webrtc.RTPCodecParameters {
+	return []webrtc.RTPCodecParameters{c.codec}
+}
+
+func (discardContext) HeaderExtensions() []webrtc.RTPHeaderExtensionParameter { return nil }
+func (discardContext) SSRC() webrtc.SSRC                                      { return 1 }
+func (discardContext) SSRCRetransmission() webrtc.SSRC                        { return 0 }
+func (discardContext) SSRCForwardErrorCorrection() webrtc.SSRC                { return 0 }
+func (discardContext) WriteStream() webrtc.TrackLocalWriter                   { return discardWriter{} }
+func (discardContext) ID() string                                             { return "discard" }
+func (discardContext) RTCPReader() interceptor.RTCPReader                     { return nil }
+
+type discardWriter struct{}
+
+func (discardWriter) WriteRTP(_ *rtp.Header, payload []byte) (int, error) { return len(payload), nil }
+func (discardWriter) Write(b []byte) (int, error)                         { return len(b), nil }
+
+func bindDiscard(b *testing.B, track webrtc.TrackLocal, fourCC string) {
+	b.Helper()
+	mime, err := mimeType(fourCC)
+	if err != nil {
+		b.Fatal(err)
+	}
+	codec := webrtc.RTPCodecParameters{
+		RTPCodecCapability: webrtc.RTPCodecCapability{MimeType: mime, ClockRate: rtpcache.ClockRate},
+		PayloadType:        96,
+	}
+	if _, err = track.Bind(discardContext{codec: codec}); err != nil {
+		b.Fatal(err)
+	}
+}
+
+// BenchmarkWriteFrame measures what a send loop spends per frame on either
+// kind of track, bound to a stream that discards the packets: the payloader
+// WriteSample runs, or the payloads of the RTP cache.
+func BenchmarkWriteFrame(b *testing.B) {
+	for _, fourCC := range []string{"VP80", "VP90", "AV01"} {
+		video, err := framestore.Load(ivftest.Temp(b, fourCC, 300, 6000))
+		if err != nil {
+			b.Fatal(err)
+		}
+
+		b.Run(fourCC+"/sample", func(b *testing.B) {
+			track, err := newVideoTrack(video.Header)
+			if err != nil {
+				b.Fatal(err)
+			}
+			bindDiscard(b, track, fourCC)
+			benchWriteFrame(b, sampleTrack{track}, video)
+		})
+		b.Run(fourCC+"/cache", func(b *testing.B) {
+			track, err := newPacketTrack(rtpcache.New(0), []*framestore.Video{video})
+			if err != nil {
+				b.Fatal(err)
+			}
+			bindDiscard(b, track, fourCC)
+			benchWriteFrame(b, track, video)
+		})
+	}
+}
+
+func benchWriteFrame(b *testing.B, track frameTrack, video *framestore.Video) {
+	var position time.Duration
+	b.SetBytes(int64(video.Size() / video.FrameCount()))
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		j := i % video.FrameCount()
+		if _, err := track.writeFrame(video, j, position); err != nil {
+			b.Fatal(err)
+		}
+		position += video.FrameDuration(j)
+	}
+	b.ReportMetric(float64(b.N)/b.Elapsed().Seconds(), "frames/s")
+}
@@ -0,0 +1,219 @@
+package server
+
+import (
+	"bwe/demo/pkg/abstime"
+	"bwe/demo/pkg/pacer"
+	"bwe/demo/pkg/pipeline"
+	"bwe/demo/pkg/probe"
+	"fmt"
+	"slices"
+	"sync"
+
+	"github.com/pion/interceptor"
+	"github.com/pion/interceptor/pkg/cc"
+	"github.com/pion/interceptor/pkg/gcc"
+	"github.com/pion/interceptor/pkg/stats"
+	"github.com/pion/logging"
+	"github.com/pion/transport/v3"
+	"github.com/pion/webrtc/v4"
+)
+
+// PeerConnection is a peer connection together with the interceptor state
+// bound to it. Estimator and Pacer are nil when disabled in the config.
+type PeerConnection struct {
+	*webrtc.PeerConnection
+	Estimator cc.BandwidthEstimator
+	Pacer     *pacer.Pacer
+	// Prober is nil unless probing is enabled with the estimator.
+	Prober *probe.Prober
+	// FirstPacket is closed once the first RTP packet has been sent.
+	FirstPacket <-chan struct{}
+	// Stats is nil unless the sender report is enabled.
+	Stats    stats.Getter
+	Feedback *feedbackSet
+}
+
+// connectionBuilder collects interceptor state for the connection under
+// construction. Interceptors report it from inside NewPeerConnection, so
+// construction is serialized to pair them up.
+type connectionBuilder struct {
+	mu      sync.Mutex
+	current *PeerConnection
+}
+
+type PeerConnectionFactory struct {
+	api          *webrtc.API
+	iceServer    string
+	builder      *connectionBuilder
+	certificates *certificateCache
+}
+
+// newPeerConnectionFactory builds the shared webrtc.API. A nil network uses
+// the host's.
+func newPeerConnectionFactory(config Config, network transport.Net) (PeerConnectionFactory, error) {
+	m := &webrtc.MediaEngine{}
+	err := m.RegisterDefaultCodecs()
+	if err != nil {
+		return PeerConnectionFactory{}, fmt.Errorf("register default codecs: %w", err)
+	}
+
+	err = abstime.RegisterHeaderExtensions(m)
+	if err != nil {
+		return PeerConnectionFactory{}, err
+	}
+
+	ir := &interceptor.Registry{}
+	builder := &connectionBuilder{}
+
+	// Send time is stamped closest to the network, after the pacer.
+	ir.Add(abstime.NewSendTimeInterceptor())
+
+	ir.Add(&firstPacketFactory{onNewPeerConnection: func(sent <-chan struct{}) {
+		builder.current.FirstPacket = sent
+	}})
+
+	if config.BWE.Enabled {
+		err = registerCongestionController(m, ir, config, builder)
+		if err != nil {
+			return PeerConnectionFactory{}, err
+		}
+	}
+
+	err = pipeline.Register(m, ir, config.Pipeline)
+	if err != nil {
+		return PeerConnectionFactory{}, fmt.Errorf("register pipeline: %w", err)
+	}
+
+	if config.Report.File != "" {
+		si, err := stats.NewInterceptor()
+		if err != nil {
+			return PeerConnectionFactory{}, fmt.Errorf("new stats interceptor: %w", err)
+		}
+		si.OnNewPeerConnection(func(id string, getter stats.Getter) {
+			builder.current.Stats = getter
+		})
+		ir.Add(si)
+	}
+
+	// Without an estimator the pacer runs as the outermost interceptor at a
+	// fixed rate.
+	if config.Pacer.Enabled && !config.BWE.Enabled {
+		pi := pacer.NewInterceptor(config.Pacer.Config)
+		pi.OnNewPeerConnection(func(id string, p *pacer.Pacer) {
+			builder.current.Pacer = p
+		})
+		ir.Add(pi)
+	}
+
+	// Probes are numbered with the media, so the prober sits outside the
+	// NACK responder and the TWCC sender.
+	if config.BWE.Enabled && config.BWE.Probe.Enabled {
+		pr := probe.NewInterceptor()
+		pr.OnNewPeerConnection(func(id string, p *probe.Prober) {
+			builder.current.Prober = p
+		})
+		ir.Add(pr)
+	}
+
+	// Capture time is stamped as the track writes a frame, before any
+	// queueing.
+	ir.Add(abstime.NewCaptureTimeInterceptor())
+
+	se := webrtc.SettingEngine{}
+	se.LoggerFactory = logging.NewDefaultLoggerFactory()
+	if network != nil {
+		se.SetNet(network)
+	}
+	err = configureTransport(&se, config.Transport, se.LoggerFactory)
+	if err != nil {
+		return PeerConnectionFactory{}, fmt.Errorf("configure transport: %w", err)
+	}
+
+	var certificates *certificateCache
+	if config.Transport.SharedCertificate {
+		certificates = &certificateCache{}
+	}
+
+	return PeerConnectionFactory{
+		api:          webrtc.NewAPI(webrtc.WithMediaEngine(m), webrtc.WithInterceptorRegistry(ir), webrtc.WithSettingEngine(se)),
+		iceServer:    config.IceServer,
+		builder:      builder,
+		certificates: certificates,
+	}, nil
+}
+
+func registerCongestionController(m *webrtc.MediaEngine, ir *interceptor.Registry, config Config, builder *connectionBuilder) error {
+	var options []gcc.Option
+	if config.BWE.InitialBitrate > 0 {
+		options = append(options, gcc.SendSideBWEInitialBitrate(config.BWE.InitialBitrate))
+	}
+	if config.BWE.MinBitrate > 0 {
+		options = append(options, gcc.SendSideBWEMinBitrate(config.BWE.MinBitrate))
+	}
+	if config.BWE.MaxBitrate > 0 {
+		options = append(options, gcc.SendSideBWEMaxBitrate(config.BWE.MaxBitrate))
+	}
+
+	pacerConfig := config.Pacer.Config
+	if config.BWE.InitialBitrate > 0 {
+		pacerConfig.InitialBitrate = config.BWE.InitialBitrate
+	}
+
+	congestionController, err := cc.NewInterceptor(func() (cc.BandwidthEstimator, error) {
+		if !config.Pacer.Enabled {
+			return gcc.NewSendSideBWE(options...)
+		}
+
+		p := pacer.New(pacerConfig)
+		builder.current.Pacer = p
+		return gcc.NewSendSideBWE(append(slices.Clone(options), gcc.SendSideBWEPacer(p))...)
+	})
+	if err != nil {
+		return fmt.Errorf("new congestion controller: %w", err)
+	}
+
+	congestionController.OnNewPeerConnection(func(id string, estimator cc.BandwidthEstimator) {
+		builder.current.Estimator = estimator
+	})
+	ir.Add(congestionController)
+
+	err = webrtc.ConfigureTWCCHeaderExtensionSender(m, ir)
+	if err != nil {
+		return fmt.Errorf("configure twcc header extension sender: %w", err)
+	}
+
+	return nil
+}
+
+func (f PeerConnectionFactory) New() (PeerConnection, error) {
+	configuration := webrtc.Configuration{}
+	if f.iceServer != "" {
+		configuration.ICEServers = []webrtc.ICEServer{
+			{
+				URLs: []string{f.iceServer},
+			},
+		}
+	}
+	if f.certificates != nil {
+		certificate, err := f.certificates.Get()
+		if err != nil {
+			return PeerConnection{}, err
+		}
+		configuration.Certificates = []webrtc.Certificate{certificate}
+	}
+
+	f.builder.mu.Lock()
+	defer f.builder.mu.Unlock()
+
+	result := PeerConnection{Feedback: &feedbackSet{}}
+	f.builder.current = &result
+	defer func() { f.builder.current = nil }()
+
+	pc, err := f.api.NewPeerConnection(configuration)
+	if err != nil {
+		return PeerConnection{}, err
+	}
+	result.PeerConnection = pc
+
+	return result, nil
+}
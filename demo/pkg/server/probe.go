@@ -0,0 +1,89 @@
+package server
+
+import (
+	"bwe/demo/pkg/attr"
+	"bwe/demo/pkg/probe"
+	"log/slog"
+	"time"
+)
+
+// probing schedules the probe clusters of sessions. maxBitrate caps a
+// cluster, zero for no cap.
+type probing struct {
+	config     probe.Config
+	maxBitrate int
+}
+
+// start probes the session once ICE connects: the initial clusters back to
+// back, then one every Interval. Results are logged with the time since the
+// connection came up, to measure how fast the estimate settles.
+func (p probing) start(session *Session) {
+	if session.pc.Prober == nil || session.pc.Estimator == nil {
+		return
+	}
+
+	session.Go(func() {
+		if !session.waitConnected() {
+			return
+		}
+		connected := time.Now()
+
+		if !p.probe(session, connected, p.config.InitialFactors) || p.config.Interval <= 0 {
+			return
+		}
+
+		ticker := time.NewTicker(p.config.Interval)
+		defer ticker.Stop()
+		for {
+			select {
+			case <-session.Done():
+				return
+			case <-ticker.C:
+			}
+
+			if !p.probe(session, connected, []float64{p.config.Factor}) {
+				return
+			}
+		}
+	})
+}
+
+// probe sends a cluster per factor of the current estimate and logs the
+// estimate ResultDelay later. It returns false once the session is done.
+func (p probing) probe(session *Session, connected time.Time, factors []float64) bool {
+	before := session.pc.Estimator.GetTargetBitrate()
+
+	clusters := make([]probe.Cluster, 0, len(factors))
+	for _, factor := range factors {
+		bitrate := int(float64(before) * factor)
+		if p.maxBitrate > 0 {
+			bitrate = min(bitrate, p.maxBitrate)
+		}
+
+		cluster := session.pc.Prober.Probe(session.Done(), bitrate, p.config.ClusterDuration)
+		probeClusters.Inc()
+		probeBytes.Add(uint64(cluster.Bytes))
+		clusters = append(clusters, cluster)
+	}
+
+	select {
+	case <-session.Done():
+		return false
+	case <-time.After(p.config.ResultDelay):
+	}
+
+	after := session.pc.Estimator.GetTargetBitrate()
+	for _, cluster := range clusters {
+		slog.Info("probe result",
+			attr.Session(session.ID),
+			slog.Int("cluster", cluster.ID),
+			attr.Bitrate(cluster.Bitrate),
+			slog.Int("sent_bitrate", cluster.SentBitrate()),
+			slog.Int("packets", cluster.Packets),
+			slog.Int("estimate_before", before),
+			slog.Int("estimate_after", after),
+			slog.Duration("since_connected", time.Since(connected)),
+		)
+	}
+	return true
+}
@@ -0,0 +1,74 @@
+package server
+
+import (
+	"bwe/demo/pkg/framestore"
+	"time"
+)
+
+// keyframeRecovery answers keyframe requests of one session track. A
+// request that arrives within the minimum interval of the last jump waits
+// until the interval has passed, unless a natural keyframe comes first.
+type keyframeRecovery struct {
+	requests    <-chan time.Time
+	minInterval time.Duration
+
+	pending time.Time
+	last    time.Time
+}
+
+// newRecovery returns nil when recovery is disabled.
+func (p Playback) newRecovery(feedback *senderFeedback) *keyframeRecovery {
+	if !p.Recovery.Enabled {
+		return nil
+	}
+	return &keyframeRecovery{requests: feedback.keyframeRequests, minInterval: p.Recovery.MinInterval}
+}
+
+// next returns the frame to send in place of frame i of video: the nearest
+// keyframe while a request is pending, otherwise i.
+func (r *keyframeRecovery) next(video *framestore.Video, i int) int {
+	if r == nil || i >= video.FrameCount() {
+		return i
+	}
+
+	select {
+	case requested := <-r.requests:
+		if r.pending.IsZero() {
+			r.pending = requested
+		}
+	default:
+	}
+	if r.pending.IsZero() {
+		return i
+	}
+
+	now := time.Now()
+	if !video.FrameInfo(i).Keyframe {
+		if now.Sub(r.last) < r.minInterval {
+			return i
+		}
+		i = nearestKeyframe(video, i)
+		keyframeJumps.Inc()
+	}
+
+	keyframeResponse.Observe(now.Sub(r.pending).Seconds())
+	r.pending = time.Time{}
+	r.last = now
+	return i
+}
+
+// nearestKeyframe returns the keyframe closest to frame i. Jumping back
+// repeats a few frames, jumping ahead skips them; either way the decoder
+// recovers on the next frame sent.
+func nearestKeyframe(video *framestore.Video, i int) int {
+	before := video.KeyframeBefore(i)
+	after := video.KeyframeAfter(i)
+	switch {
+	case after < 0:
+		return before
+	case !video.FrameInfo(before).Keyframe || after-i < i-before:
+		return after
+	default:
+		return before
+	}
+}
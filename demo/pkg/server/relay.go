@@ -0,0 +1,444 @@
+package server
+
+import (
+	"bwe/demo/pkg/attr"
+	"bwe/demo/pkg/signal"
+	"errors"
+	"fmt"
+	"io"
+	"log/slog"
+	"slices"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"github.com/pion/rtcp"
+	"github.com/pion/rtp"
+	"github.com/pion/webrtc/v4"
+	"golang.org/x/net/websocket"
+)
+
+const (
+	upstreamRetry = 2 * time.Second
+	// upstreamWait bounds how long a viewer of an edge waits for the
+	// upstream tracks.
+	upstreamWait = 10 * time.Second
+	// upstreamKeyframeInterval is the least time between keyframe requests
+	// the edge forwards for one track, however many viewers ask.
+	upstreamKeyframeInterval = time.Second
+	// upstreamRateInterval is how often the relayed bitrate is measured for
+	// admission.
+	upstreamRateInterval = 2 * time.Second
+)
+
+// relayConfig is the config of peer connections between origin and edges.
+// They carry every rendition at full rate, so there is no estimator, pacer
+// or report, and they keep off the shared viewer sockets.
+func relayConfig(config Config) Config {
+	config.BWE.Enabled = false
+	config.Pacer.Enabled = false
+	config.Report.File = ""
+	config.Transport.UDPPort = 0
+	config.Transport.TCPPort = 0
+	return config
+}
+
+// Upstream subscribes an edge to the relay endpoint of the origin over one
+// peer connection and fans the received RTP out to local tracks. The tracks
+// outlive reconnects, so viewers keep their senders while the upstream
+// connection is re-established.
+type Upstream struct {
+	url     string
+	factory PeerConnectionFactory
+	// onBitrate receives the measured bitrate of all relayed tracks and of
+	// the cheapest one.
+	onBitrate func(full, lowest int)
+
+	mu       sync.Mutex
+	tracks   []*relayTrack
+	expected int
+	ready    chan struct{}
+	// pc is the current upstream connection, nil while reconnecting.
+	pc *webrtc.PeerConnection
+
+	done chan struct{}
+	wg   sync.WaitGroup
+}
+
+// relayTrack is the local track relaying one upstream track.
+type relayTrack struct {
+	local *webrtc.TrackLocalStaticRTP
+	// bytes counts the relayed RTP for the bitrate measurement, bitrate is
+	// the last measurement of the track.
+	bytes   atomic.Uint64
+	bitrate atomic.Int64
+
+	// ssrc is the upstream track of the current connection and
+	// lastKeyframeRequest when one was last forwarded for it, guarded by
+	// Upstream.mu.
+	ssrc                webrtc.SSRC
+	lastKeyframeRequest time.Time
+
+	// forwarding is held by the forwarder of the track, so the one of a new
+	// connection waits for the one of the old connection to end.
+	forwarding sync.Mutex
+	rewrite    rtpRewriter
+}
+
+func newUpstream(url string, factory PeerConnectionFactory, onBitrate func(full, lowest int)) *Upstream {
+	return &Upstream{
+		url:       url,
+		factory:   factory,
+		onBitrate: onBitrate,
+		ready:     make(chan struct{}),
+		done:      make(chan struct{}),
+	}
+}
+
+// start keeps an upstream connection open until close.
+func (u *Upstream) start() {
+	u.wg.Add(1)
+	go func() {
+		defer u.wg.Done()
+		for {
+			err := u.subscribe()
+			upstreamConnected.Set(0)
+			if err != nil {
+				slog.Error("subscribe upstream", attr.Error(err))
+			}
+
+			select {
+			case <-u.done:
+				return
+			case <-time.After(upstreamRetry):
+			}
+		}
+	}()
+
+	u.wg.Add(1)
+	go func() {
+		defer u.wg.Done()
+		u.measure()
+	}()
+}
+
+// measure reports the bitrate relayed over each upstreamRateInterval, in
+// total and per track. While nothing is relayed the last measurement stands.
+func (u *Upstream) measure() {
+	ticker := time.NewTicker(upstreamRateInterval)
+	defer ticker.Stop()
+
+	last := time.Now()
+	var relayed []uint64
+	for {
+		select {
+		case <-u.done:
+			return
+		case <-ticker.C:
+		}
+
+		u.mu.Lock()
+		tracks := slices.Clone(u.tracks)
+		u.mu.Unlock()
+
+		now := time.Now()
+		seconds := now.Sub(last).Seconds()
+		last = now
+		if len(relayed) < len(tracks) {
+			relayed = append(relayed, make([]uint64, len(tracks)-len(relayed))...)
+		}
+
+		full, lowest, measured := 0, 0, false
+		for i, track := range tracks {
+			if track == nil {
+				continue
+			}
+			total := track.bytes.Load()
+			if total == relayed[i] {
+				continue
+			}
+			bitrate := int(float64(total-relayed[i]) * 8 / seconds)
+			relayed[i] = total
+			track.bitrate.Store(int64(bitrate))
+			full += bitrate
+			if !measured || bitrate < lowest {
+				lowest = bitrate
+			}
+			measured = true
+		}
+		if measured {
+			u.onBitrate(full, lowest)
+		}
+	}
+}
+
+// lowestTrack returns the relayed track with the lowest measured bitrate,
+// the first one if none was measured yet.
+func lowestTrack(tracks []*relayTrack) *relayTrack {
+	lowest := tracks[0]
+	for _, track := range tracks[1:] {
+		bitrate := track.bitrate.Load()
+		if bitrate > 0 && (lowest.bitrate.Load() == 0 || bitrate < lowest.bitrate.Load()) {
+			lowest = track
+		}
+	}
+	return lowest
+}
+
+func (u *Upstream) close() {
+	close(u.done)
+	u.wg.Wait()
+}
+
+// Tracks returns the relayed tracks once every track of the origin has been
+// received. It returns false if done is closed or upstreamWait passes first.
+func (u *Upstream) Tracks(done <-chan struct{}) ([]*relayTrack, bool) {
+	select {
+	case <-u.ready:
+	case <-done:
+		return nil, false
+	case <-time.After(upstreamWait):
+		return nil, false
+	}
+
+	u.mu.Lock()
+	defer u.mu.Unlock()
+	return slices.Clone(u.tracks), true
+}
+
+// forwardKeyframes forwards the keyframe requests of a viewer of track to
+// the origin until done. Requests of all viewers of the track within
+// upstreamKeyframeInterval of the last one forwarded are answered by it.
+func (u *Upstream) forwardKeyframes(track *relayTrack, feedback *senderFeedback, done <-chan struct{}) {
+	for {
+		select {
+		case <-done:
+			return
+		case <-feedback.keyframeRequests:
+		}
+
+		u.mu.Lock()
+		pc, ssrc := u.pc, track.ssrc
+		forward := pc != nil && time.Since(track.lastKeyframeRequest) >= upstreamKeyframeInterval
+		if forward {
+			track.lastKeyframeRequest = time.Now()
+		}
+		u.mu.Unlock()
+		if !forward {
+			continue
+		}
+
+		err := pc.WriteRTCP([]rtcp.Packet{&rtcp.PictureLossIndication{MediaSSRC: uint32(ssrc)}})
+		if err != nil {
+			slog.Error("forward keyframe request", attr.Error(err))
+			continue
+		}
+		relayKeyframeRequests.Inc()
+	}
+}
+
+// subscribe runs one upstream connection until it fails or close is called.
+func (u *Upstream) subscribe() error {
+	wsConfig, err := websocket.NewConfig(u.url, "http://localhost")
+	if err != nil {
+		return fmt.Errorf("new ws config: %w", err)
+	}
+
+	ws, err := websocket.DialConfig(wsConfig)
+	if err != nil {
+		return fmt.Errorf("dial ws: %w", err)
+	}
+	defer ws.Close()
+
+	pc, err := u.factory.New()
+	if err != nil {
+		return fmt.Errorf("new peer connection: %w", err)
+	}
+
+	u.mu.Lock()
+	u.pc = pc.PeerConnection
+	u.mu.Unlock()
+
+	// Closing the peer connection ends the forwarders.
+	defer func() {
+		u.mu.Lock()
+		u.pc = nil
+		u.mu.Unlock()
+
+		err = pc.Close()
+		if err != nil {
+			slog.Error("close upstream peer connection", attr.Error(err))
+		}
+	}()
+
+	ended := make(chan struct{})
+	var end sync.Once
+	go func() {
+		select {
+		case <-ended:
+		case <-u.done:
+		}
+		_ = ws.Close()
+	}()
+	defer end.Do(func() { close(ended) })
+
+	pc.OnConnectionStateChange(func(state webrtc.PeerConnectionState) {
+		slog.Info("upstream connection state changed", attr.State(state))
+		switch state {
+		case webrtc.PeerConnectionStateConnected:
+			upstreamConnected.Set(1)
+		case webrtc.PeerConnectionStateFailed, webrtc.PeerConnectionStateClosed:
+			end.Do(func() { close(ended) })
+		}
+	})
+
+	pc.OnTrack(func(remote *webrtc.TrackRemote, receiver *webrtc.RTPReceiver) {
+		index := slices.Index(pc.GetTransceivers(), receiver.RTPTransceiver())
+		track, err := u.track(index, remote.Codec().RTPCodecCapability, remote.SSRC())
+		if err != nil {
+			slog.Error("relay track", attr.Mid(receiver.RTPTransceiver().Mid()), attr.Error(err))
+			return
+		}
+
+		forward(remote, track, remote.Codec().ClockRate)
+	})
+
+	signalConn := signal.NewConn(ws)
+	pc.OnICECandidate(func(candidate *webrtc.ICECandidate) {
+		if err := signalConn.SendCandidate(candidate); err != nil {
+			slog.Error("send local candidate", attr.Error(err))
+		}
+	})
+
+	offer, err := signalConn.Receive()
+	if err != nil {
+		return fmt.Errorf("receive offer: %w", err)
+	}
+	if offer.Type == signal.TypeError {
+		return fmt.Errorf("subscription refused: %s", offer.Error)
+	}
+
+	err = pc.SetRemoteDescription(offer.SessionDescription())
+	if err != nil {
+		return fmt.Errorf("set remote description: %w", err)
+	}
+	u.expect(len(pc.GetTransceivers()))
+
+	answer, err := pc.CreateAnswer(nil)
+	if err != nil {
+		return fmt.Errorf("create answer: %w", err)
+	}
+
+	err = pc.SetLocalDescription(answer)
+	if err != nil {
+		return fmt.Errorf("set local description: %w", err)
+	}
+
+	err = signalConn.SendDescription(answer)
+	if err != nil {
+		return fmt.Errorf("send local description: %w", err)
+	}
+
+	for {
+		message, err := signalConn.Receive()
+		if err != nil {
+			select {
+			case <-u.done:
+				return nil
+			default:
+				return fmt.Errorf("upstream closed: %w", err)
+			}
+		}
+
+		if message.Type != signal.TypeCandidate || message.Candidate == nil {
+			slog.Error("unexpected signaling message", attr.Type(message.Type))
+			continue
+		}
+
+		err = pc.AddICECandidate(*message.Candidate)
+		if err != nil {
+			slog.Error("add remote candidate", attr.Error(err))
+		}
+	}
+}
+
+// expect records how many tracks the origin offered. The first connection
+// fixes the track set for the lifetime of the edge.
+func (u *Upstream) expect(count int) {
+	u.mu.Lock()
+	defer u.mu.Unlock()
+	if u.expected == 0 {
+		u.expected = count
+		u.tracks = make([]*relayTrack, count)
+	}
+}
+
+// track returns the local track relaying the index-th upstream track, ssrc
+// on the current connection, creating it on the first connection.
+func (u *Upstream) track(index int, codec webrtc.RTPCodecCapability, ssrc webrtc.SSRC) (*relayTrack, error) {
+	u.mu.Lock()
+	defer u.mu.Unlock()
+
+	if index < 0 || index >= len(u.tracks) {
+		return nil, fmt.Errorf("unexpected upstream track %d of %d", index, len(u.tracks))
+	}
+
+	if track := u.tracks[index]; track != nil {
+		if track.local.Codec().MimeType != codec.MimeType {
+			return nil, fmt.Errorf("upstream track %d changed codec from %s to %s", index, track.local.Codec().MimeType, codec.MimeType)
+		}
+		track.ssrc = ssrc
+		return track, nil
+	}
+
+	local, err := webrtc.NewTrackLocalStaticRTP(codec, "video", "pion")
+	if err != nil {
+		return nil, fmt.Errorf("new track local: %w", err)
+	}
+	track := &relayTrack{local: local, ssrc: ssrc}
+	u.tracks[index] = track
+
+	if !slices.Contains(u.tracks, nil) {
+		close(u.ready)
+	}
+	return track, nil
+}
+
+// forward copies RTP from the upstream track to the local one until the
+// upstream connection closes. Header extensions were negotiated with the
+// origin and are dropped; the edge interceptors stamp their own. Sequence
+// numbers and timestamps continue those sent before a reconnect.
+func forward(remote *webrtc.TrackRemote, track *relayTrack, clockRate uint32) {
+	track.forwarding.Lock()
+	defer track.forwarding.Unlock()
+	track.rewrite.rebase(clockRate)
+
+	buffer := make([]byte, 1500)
+	var packet rtp.Packet
+	for {
+		n, _, err := remote.Read(buffer)
+		if err != nil {
+			if !errors.Is(err, io.EOF) {
+				slog.Error("read upstream track", attr.Error(err))
+			}
+			return
+		}
+
+		err = packet.Unmarshal(buffer[:n])
+		if err != nil {
+			continue
+		}
+		packet.Header.Extension = false
+		packet.Header.ExtensionProfile = 0
+		packet.Header.Extensions = packet.Header.Extensions[:0]
+		track.rewrite.apply(&packet.Header, time.Now())
+
+		// A failed write only means some viewer's binding is gone, the
+		// others still got the packet.
+		if err := track.local.WriteRTP(&packet); err != nil {
+			relayWriteErrors.Inc()
+		}
+		relayedPackets.Inc()
+		track.bytes.Add(uint64(n))
+	}
+}
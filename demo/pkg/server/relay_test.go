@@ -0,0 +1,19 @@
+package server
+
+import "testing"
+
+// TestLowestTrack checks that degraded edge viewers get the cheapest
+// measured track.
+func TestLowestTrack(t *testing.T) {
+	tracks := []*relayTrack{{}, {}, {}}
+	if lowestTrack(tracks) != tracks[0] {
+		t.Fatal("the first track should stand in before a measurement")
+	}
+
+	tracks[0].bitrate.Store(2000)
+	tracks[1].bitrate.Store(300)
+	tracks[2].bitrate.Store(800)
+	if lowestTrack(tracks) != tracks[1] {
+		t.Fatal("the cheapest track was not chosen")
+	}
+}
@@ -0,0 +1,248 @@
+package server
+
+import (
+	"bwe/demo/pkg/attr"
+	"bwe/demo/pkg/framestore"
+	"errors"
+	"fmt"
+	"log/slog"
+	"slices"
+	"sync"
+	"time"
+)
+
+// catalog is the list of video paths offered to new sessions. Reload
+// replaces the list, it is never modified in place.
+type catalog struct {
+	mu   sync.Mutex
+	list []string
+
+	// reload serializes reloads.
+	reload sync.Mutex
+}
+
+func newCatalog(paths []string) *catalog {
+	return &catalog{list: paths}
+}
+
+func (c *catalog) paths() []string {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	return c.list
+}
+
+// acquire returns the acquired current versions of the catalog paths in
+// catalog order, leaving out paths without one. Reload removes paths under
+// the same lock, so a removed path is never loaded again.
+func (c *catalog) acquire(store *framestore.Store) []*framestore.Video {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+
+	videos := make([]*framestore.Video, 0, len(c.list))
+	for _, path := range c.list {
+		if video := store.Current(path); video != nil && video.Acquire() {
+			videos = append(videos, video)
+		}
+	}
+	return videos
+}
+
+// acquirePath returns the acquired current version of path, or nil if it
+// has none or left the catalog.
+func (c *catalog) acquirePath(store *framestore.Store, path string) *framestore.Video {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+
+	if !slices.Contains(c.list, path) {
+		return nil
+	}
+	if video := store.Current(path); video != nil && video.Acquire() {
+		return video
+	}
+	return nil
+}
+
+// update replaces the list with paths and calls remove for every path that
+// left it. It returns how many remove reported removed.
+func (c *catalog) update(paths []string, remove func(path string) bool) int {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+
+	removed := 0
+	for _, path := range c.list {
+		if !slices.Contains(paths, path) && remove(path) {
+			removed++
+		}
+	}
+	c.list = paths
+	return removed
+}
+
+// Reload makes paths the videos of new sessions. Changed and added files
+// are loaded, indexed and, with the RTP cache, packetized before they are
+// published, so no session ever waits for them. Running loops move to the
+// new version of their video at its next keyframe; versions no longer
+// current are freed when the last loop leaves them. A file that fails to
+// load keeps its previous version, if any. The broadcast keeps its
+// renditions, only their versions follow.
+func (h Handler) Reload(paths []string) error {
+	h.catalog.reload.Lock()
+	defer h.catalog.reload.Unlock()
+
+	start := time.Now()
+	var errs []error
+	loaded := make([]*framestore.Video, 0, len(paths))
+	available := make([]string, 0, len(paths))
+	for _, path := range paths {
+		if slices.Contains(available, path) {
+			continue
+		}
+
+		changed, err := h.FrameStore.Changed(path)
+		if err == nil && changed {
+			var video *framestore.Video
+			video, err = h.prepare(path)
+			if err == nil {
+				loaded = append(loaded, video)
+			}
+		}
+		if err != nil {
+			errs = append(errs, fmt.Errorf("%s: %w", path, err))
+			if h.FrameStore.Current(path) == nil {
+				continue
+			}
+		}
+		available = append(available, path)
+	}
+
+	for _, video := range loaded {
+		h.FrameStore.Publish(video)
+		videoVersions.Inc()
+		slog.Info("publish video", attr.Path(video.Path), attr.Bitrate(video.Bitrate()))
+	}
+
+	removed := h.catalog.update(available, func(path string) bool {
+		if h.broadcasts(path) {
+			return false
+		}
+		h.FrameStore.Remove(path)
+		return true
+	})
+
+	videoReloads.Inc()
+	slog.Info("reload videos",
+		slog.Int("videos", len(available)),
+		slog.Int("loaded", len(loaded)),
+		slog.Int("removed", removed),
+		slog.Int("failed", len(errs)),
+		slog.Duration("elapsed", time.Since(start)),
+	)
+	return errors.Join(errs...)
+}
+
+// prepare loads a new version of the video at path and warms the RTP cache
+// with it.
+func (h Handler) prepare(path string) (*framestore.Video, error) {
+	video, err := framestore.Load(path)
+	if err != nil {
+		return nil, fmt.Errorf("load video: %w", err)
+	}
+	if video.FrameCount() == 0 {
+		video.Release()
+		return nil, errors.New("no frames")
+	}
+
+	if h.Packets != nil {
+		if _, err = h.Packets.Get(video); err != nil {
+			h.Packets.Remove(video)
+			video.Release()
+			return nil, fmt.Errorf("packetize: %w", err)
+		}
+	}
+	return video, nil
+}
+
+// broadcasts reports whether a broadcast rendition plays path. Its
+// versions stay in the store for the producer to follow.
+func (h Handler) broadcasts(path string) bool {
+	if h.Broadcast == nil {
+		return false
+	}
+	return slices.ContainsFunc(h.Broadcast.renditions, func(r *rendition) bool {
+		return r.video.Load().Path == path
+	})
+}
+
+// versions keeps a send loop on the current versions of its videos. The
+// loop checks at keyframes; between reloads that costs an atomic load.
+type versions struct {
+	store      *framestore.Store
+	generation uint64
+}
+
+func newVersions(store *framestore.Store) *versions {
+	return &versions{store: store, generation: store.Generation()}
+}
+
+// acquire takes a reference to video for the loop, or to its current
+// version if video was freed since the loop got it. It returns nil if
+// neither is left.
+func (v *versions) acquire(video *framestore.Video) *framestore.Video {
+	if video.Acquire() {
+		return video
+	}
+	current := v.store.Current(video.Path)
+	if current == nil || current.Header.FourCC != video.Header.FourCC || !current.Acquire() {
+		return nil
+	}
+	return current
+}
+
+// fork returns versions for another loop, as of the same generation.
+func (v *versions) fork() *versions {
+	forked := *v
+	return &forked
+}
+
+// changed reports whether versions were published or removed since the
+// last call.
+func (v *versions) changed() bool {
+	generation := v.store.Generation()
+	if generation == v.generation {
+		return false
+	}
+	v.generation = generation
+	return true
+}
+
+// next returns the acquired current version of video if it is a newer one
+// the track can send, or nil. The caller releases video when it switches.
+func (v *versions) next(video *framestore.Video) *framestore.Video {
+	current := v.store.Current(video.Path)
+	if current == nil || current == video {
+		return nil
+	}
+	if current.Header.FourCC != video.Header.FourCC {
+		slog.Warn("keep video version", attr.Path(video.Path), slog.String("fourcc", current.Header.FourCC))
+		return nil
+	}
+	if !current.Acquire() {
+		return nil
+	}
+	return current
+}
+
+// follow moves the loop at keyframe i of video to the next version, if
+// any, and returns the video and frame to continue with.
+func (v *versions) follow(video *framestore.Video, i int) (*framestore.Video, int) {
+	if !v.changed() {
+		return video, i
+	}
+	next := v.next(video)
+	if next == nil {
+		return video, i
+	}
+	i = next.Resume(video, i)
+	video.Release()
+	return next, i
+}
@@ -0,0 +1,175 @@
+package server
+
+import (
+	"bwe/demo/pkg/attr"
+	"bwe/demo/pkg/framestore"
+	"bwe/demo/pkg/signal"
+	"context"
+	"errors"
+	"fmt"
+	"log/slog"
+	"slices"
+	"time"
+
+	"github.com/pion/webrtc/v4"
+)
+
+var errFixedTracks = errors.New("session tracks cannot be changed")
+
+// sessionTrack is a per-session track of one video. Renegotiation stops it
+// and removes its sender.
+type sessionTrack struct {
+	video    *framestore.Video
+	sender   *webrtc.RTPSender
+	feedback *senderFeedback
+	cancel   context.CancelFunc
+}
+
+// negotiator renegotiates a live session on request of the client. The
+// server stays the offerer, so there is no glare: a request arriving while
+// an offer is outstanding is merged into the next one, sent once the answer
+// is applied.
+type negotiator struct {
+	h       Handler
+	session *Session
+	conn    *signal.Conn
+
+	// offered is when the outstanding renegotiation offer was sent, zero
+	// if there is none.
+	offered time.Time
+	pending *signal.Message
+}
+
+// request handles a renegotiate message.
+func (n *negotiator) request(message signal.Message) {
+	if n.session.pc.SignalingState() == webrtc.SignalingStateStable {
+		n.offer(message)
+		return
+	}
+
+	if n.pending == nil {
+		n.pending = &message
+		return
+	}
+	n.pending.ICERestart = n.pending.ICERestart || message.ICERestart
+	if len(message.Videos) > 0 {
+		n.pending.Videos = message.Videos
+	}
+}
+
+// answered is called once an answer was applied. It sends the pending
+// renegotiation, if any.
+func (n *negotiator) answered() {
+	if !n.offered.IsZero() {
+		elapsed := time.Since(n.offered)
+		renegotiations.Inc()
+		renegotiationTime.Observe(elapsed.Seconds())
+		slog.Info("renegotiated", attr.Session(n.session.ID), slog.Duration("elapsed", elapsed))
+		n.offered = time.Time{}
+	}
+
+	if n.pending != nil {
+		message := *n.pending
+		n.pending = nil
+		n.offer(message)
+	}
+}
+
+// offer applies the requested changes and sends a new offer. A refused
+// video selection is reported to the client; changes made before the
+// failure are still offered.
+func (n *negotiator) offer(message signal.Message) {
+	if len(message.Videos) > 0 {
+		changed, err := n.h.selectVideos(n.session, message.Videos)
+		if err != nil {
+			n.refuse(err)
+			if !changed && !message.ICERestart {
+				return
+			}
+		}
+	}
+
+	offer, err := n.session.pc.CreateOffer(&webrtc.OfferOptions{ICERestart: message.ICERestart})
+	if err != nil {
+		n.refuse(fmt.Errorf("create offer: %w", err))
+		return
+	}
+
+	n.conn.HoldCandidates()
+	if err = n.session.pc.SetLocalDescription(offer); err != nil {
+		n.refuse(fmt.Errorf("set local description: %w", err))
+		return
+	}
+
+	if err = n.conn.SendDescription(offer); err != nil {
+		slog.Error("send local description", attr.Session(n.session.ID), attr.Error(err))
+		return
+	}
+	n.offered = time.Now()
+}
+
+func (n *negotiator) refuse(err error) {
+	renegotiationsRefused.Inc()
+	slog.Warn("refuse renegotiation", attr.Session(n.session.ID), attr.Error(err))
+	if err := n.conn.SendError(err.Error()); err != nil {
+		slog.Error("send refusal", attr.Error(err))
+	}
+}
+
+// selectVideos changes the per-session tracks to the videos at the given
+// indices of the current paths. Tracks of videos no longer selected stop
+// and their senders are removed; tracks of newly selected ones start from
+// the first frame. It reports whether any track changed, also on error.
+func (h Handler) selectVideos(session *Session, indices []int) (bool, error) {
+	if !session.selectable {
+		return false, errFixedTracks
+	}
+
+	available := h.catalog.paths()
+	var paths []string
+	for _, i := range indices {
+		if i < 0 || i >= len(available) {
+			return false, fmt.Errorf("no video %d", i)
+		}
+		if !slices.Contains(paths, available[i]) {
+			paths = append(paths, available[i])
+		}
+	}
+
+	changed := false
+	kept := session.tracks[:0]
+	for _, track := range session.tracks {
+		if slices.Contains(paths, track.video.Path) {
+			kept = append(kept, track)
+			continue
+		}
+
+		changed = true
+		track.cancel()
+		if err := session.pc.RemoveTrack(track.sender); err != nil {
+			slog.Error("remove track", attr.Path(track.video.Path), attr.Error(err))
+		}
+		session.pc.Feedback.remove(track.feedback)
+	}
+	session.tracks = kept
+
+	for _, path := range paths {
+		if slices.ContainsFunc(session.tracks, func(t *sessionTrack) bool { return t.video.Path == path }) {
+			continue
+		}
+
+		latest := newVersions(h.FrameStore)
+		video := h.catalog.acquirePath(h.FrameStore, path)
+		if video == nil {
+			return changed, fmt.Errorf("video %s removed", path)
+		}
+		track, err := h.startVideoTrack(session, video, latest)
+		if err != nil {
+			return changed, fmt.Errorf("start track: %w", err)
+		}
+		changed = true
+		session.tracks = append(session.tracks, track)
+	}
+
+	return changed, nil
+}
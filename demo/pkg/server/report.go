@@ -0,0 +1,110 @@
+package server
+
+import (
+	"bwe/demo/pkg/report"
+	"time"
+
+	"github.com/pion/interceptor/pkg/stats"
+)
+
+// SenderStats is the server side of the client's StreamStats. Both share
+// timestamp and ssrc, so the two reports of a session can be joined.
+type SenderStats struct {
+	Timestamp          int64   `json:"timestamp"`
+	Session            int     `json:"session"`
+	SSRC               uint32  `json:"ssrc"`
+	PacketsSent        uint64  `json:"packets_sent"`
+	BytesSent          uint64  `json:"bytes_sent"`
+	HeaderBytesSent    uint64  `json:"header_bytes_sent"`
+	PacketsLost        int64   `json:"packets_lost"`
+	FractionLost       float64 `json:"fraction_lost"`
+	Jitter             float64 `json:"jitter"`
+	RoundTripTime      float64 `json:"round_trip_time"`
+	ReceiverReports    uint32  `json:"receiver_reports"`
+	REMBBitrate        uint64  `json:"remb_bitrate"`
+	TWCCFeedback       uint32  `json:"twcc_feedback"`
+	TWCCPacketStatuses uint64  `json:"twcc_packet_statuses"`
+	FIRCount           uint32  `json:"fir_count"`
+	PLICount           uint32  `json:"pli_count"`
+	NACKCount          uint32  `json:"nack_count"`
+	NACKedPackets      uint32  `json:"nacked_packets"`
+}
+
+// senderStatsSchema lists the SenderStats fields in AppendBinary order.
+var senderStatsSchema = []report.Field{
+	{Name: "timestamp", Type: "<i8"},
+	{Name: "session", Type: "<u4"},
+	{Name: "ssrc", Type: "<u4"},
+	{Name: "packets_sent", Type: "<u8"},
+	{Name: "bytes_sent", Type: "<u8"},
+	{Name: "header_bytes_sent", Type: "<u8"},
+	{Name: "packets_lost", Type: "<i8"},
+	{Name: "fraction_lost", Type: "<f8"},
+	{Name: "jitter", Type: "<f8"},
+	{Name: "round_trip_time", Type: "<f8"},
+	{Name: "receiver_reports", Type: "<u4"},
+	{Name: "remb_bitrate", Type: "<u8"},
+	{Name: "twcc_feedback", Type: "<u4"},
+	{Name: "twcc_packet_statuses", Type: "<u8"},
+	{Name: "fir_count", Type: "<u4"},
+	{Name: "pli_count", Type: "<u4"},
+	{Name: "nack_count", Type: "<u4"},
+	{Name: "nacked_packets", Type: "<u4"},
+}
+
+func (s SenderStats) AppendBinary(b []byte) []byte {
+	b = report.AppendInt64(b, s.Timestamp)
+	b = report.AppendUint32(b, uint32(s.Session))
+	b = report.AppendUint32(b, s.SSRC)
+	b = report.AppendUint64(b, s.PacketsSent)
+	b = report.AppendUint64(b, s.BytesSent)
+	b = report.AppendUint64(b, s.HeaderBytesSent)
+	b = report.AppendInt64(b, s.PacketsLost)
+	b = report.AppendFloat64(b, s.FractionLost)
+	b = report.AppendFloat64(b, s.Jitter)
+	b = report.AppendFloat64(b, s.RoundTripTime)
+	b = report.AppendUint32(b, s.ReceiverReports)
+	b = report.AppendUint64(b, s.REMBBitrate)
+	b = report.AppendUint32(b, s.TWCCFeedback)
+	b = report.AppendUint64(b, s.TWCCPacketStatuses)
+	b = report.AppendUint32(b, s.FIRCount)
+	b = report.AppendUint32(b, s.PLICount)
+	b = report.AppendUint32(b, s.NACKCount)
+	b = report.AppendUint32(b, s.NACKedPackets)
+	return b
+}
+
+// Report is the sender stats file shared by all sessions.
+type Report = report.Queue
+
+func newReport(config ReportConfig, meta map[string]string) (*Report, error) {
+	writer, err := report.NewWriter(config.File, config.Format, senderStatsSchema, meta, config.FlushInterval)
+	if err != nil {
+		return nil, err
+	}
+
+	return report.NewQueue(writer, config.QueueSize), nil
+}
+
+func newSenderStats(session int, feedback *senderFeedback, rawStats *stats.Stats) SenderStats {
+	return SenderStats{
+		Timestamp:          time.Now().UnixNano(),
+		Session:            session,
+		SSRC:               feedback.ssrc,
+		PacketsSent:        rawStats.OutboundRTPStreamStats.PacketsSent,
+		BytesSent:          rawStats.OutboundRTPStreamStats.BytesSent,
+		HeaderBytesSent:    rawStats.HeaderBytesSent,
+		PacketsLost:        rawStats.RemoteInboundRTPStreamStats.PacketsLost,
+		FractionLost:       rawStats.RemoteInboundRTPStreamStats.FractionLost,
+		Jitter:             rawStats.RemoteInboundRTPStreamStats.Jitter,
+		RoundTripTime:      rawStats.RemoteInboundRTPStreamStats.RoundTripTime.Seconds(),
+		ReceiverReports:    feedback.receiverReports.Load(),
+		REMBBitrate:        feedback.rembBitrate.Load(),
+		TWCCFeedback:       feedback.twccFeedback.Load(),
+		TWCCPacketStatuses: feedback.twccPacketStatuses.Load(),
+		FIRCount:           rawStats.OutboundRTPStreamStats.FIRCount,
+		PLICount:           rawStats.OutboundRTPStreamStats.PLICount,
+		NACKCount:          rawStats.OutboundRTPStreamStats.NACKCount,
+		NACKedPackets:      feedback.nackedPackets.Load(),
+	}
+}
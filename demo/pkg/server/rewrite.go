@@ -0,0 +1,54 @@
+package server
+
+import (
+	"time"
+
+	"github.com/pion/rtp"
+)
+
+// rtpRewriter maps the sequence numbers and timestamps of successive RTP
+// sources onto one continuous numbering: the upstream connections of a
+// relayed track, or the renditions a broadcast viewer switches between.
+// Each source starts at its own random ones, which a receiver would take
+// for a burst of loss.
+type rtpRewriter struct {
+	clockRate uint32
+	rebasing  bool
+	seqOffset uint16
+	tsOffset  uint32
+
+	// The newest packet written, valid once started.
+	started bool
+	lastSeq uint16
+	lastTS  uint32
+	lastAt  time.Time
+}
+
+// rebase makes the next packet continue the numbering: its sequence number
+// follows the last one written and its timestamp advances by the time that
+// passed in between.
+func (r *rtpRewriter) rebase(clockRate uint32) {
+	r.clockRate = clockRate
+	r.rebasing = true
+}
+
+func (r *rtpRewriter) apply(header *rtp.Header, now time.Time) {
+	if r.rebasing {
+		r.rebasing = false
+		r.seqOffset, r.tsOffset = 0, 0
+		if r.started {
+			elapsed := uint32(now.Sub(r.lastAt).Seconds() * float64(r.clockRate))
+			r.seqOffset = r.lastSeq + 1 - header.SequenceNumber
+			r.tsOffset = r.lastTS + max(elapsed, 1) - header.Timestamp
+		}
+	}
+
+	header.SequenceNumber += r.seqOffset
+	header.Timestamp += r.tsOffset
+	if !r.started || int16(header.SequenceNumber-r.lastSeq) > 0 {
+		r.started = true
+		r.lastSeq = header.SequenceNumber
+		r.lastTS = header.Timestamp
+		r.lastAt = now
+	}
+}
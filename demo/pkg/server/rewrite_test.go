@@ -0,0 +1,52 @@
+package server
+
+import (
+	"testing"
+	"time"
+
+	"github.com/pion/rtp"
+)
+
+// TestRewriteContinues checks that a new source continues the sequence
+// numbers and advances the timestamps by the time in between, across the
+// wrap of both.
+func TestRewriteContinues(t *testing.T) {
+	var r rtpRewriter
+	now := time.Now()
+	r.rebase(90000)
+
+	for _, seq := range []uint16{65534, 65535} {
+		header := rtp.Header{SequenceNumber: seq, Timestamp: 4294960000}
+		r.apply(&header, now)
+		if header.SequenceNumber != seq || header.Timestamp != 4294960000 {
+			t.Fatalf("first source rewritten to %d/%d", header.SequenceNumber, header.Timestamp)
+		}
+	}
+
+	// 100ms later at 90 kHz, wrapped past 2^32.
+	r.rebase(90000)
+	for i, want := range []struct {
+		seq uint16
+		ts  uint32
+	}{{0, 1704}, {1, 1704 + 3000}} {
+		header := rtp.Header{SequenceNumber: 100 + uint16(i), Timestamp: 500 + uint32(i)*3000}
+		r.apply(&header, now.Add(100*time.Millisecond))
+		if header.SequenceNumber != want.seq || header.Timestamp != want.ts {
+			t.Fatalf("packet %d of the second source: %d/%d, want %d/%d", i, header.SequenceNumber, header.Timestamp, want.seq, want.ts)
+		}
+	}
+
+	// A packet reordered before the newest keeps its offset but does not
+	// become the reference of the next source.
+	header := rtp.Header{SequenceNumber: 99, Timestamp: 0}
+	r.apply(&header, now.Add(200*time.Millisecond))
+	if header.SequenceNumber != 65535 {
+		t.Fatalf("reordered packet rewritten to %d", header.SequenceNumber)
+	}
+	r.rebase(90000)
+	header = rtp.Header{SequenceNumber: 7, Timestamp: 7}
+	r.apply(&header, now.Add(100*time.Millisecond))
+	if header.SequenceNumber != 2 {
+		t.Fatalf("third source starts at %d, want 2", header.SequenceNumber)
+	}
+}
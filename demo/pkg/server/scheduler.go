@@ -0,0 +1,201 @@
+package server
+
+import (
+	"container/heap"
+	"runtime"
+	"sync"
+	"sync/atomic"
+	"time"
+)
+
+// scheduleTick is the batching window of the scheduler: every frame due
+// within it of a wakeup is released together.
+const scheduleTick = time.Millisecond
+
+// frameScheduler wakes send loops at the presentation time of their next
+// frame. Loops are spread over one shard per CPU, each a min-heap of due
+// times behind a single timer, so thousands of tracks do not each keep a
+// runtime timer and an idle shard does not wake at all.
+type frameScheduler struct {
+	shards []*scheduleShard
+	next   atomic.Uint32
+
+	done chan struct{}
+	wg   sync.WaitGroup
+}
+
+func newFrameScheduler() *frameScheduler {
+	s := &frameScheduler{
+		shards: make([]*scheduleShard, runtime.GOMAXPROCS(0)),
+		done:   make(chan struct{}),
+	}
+	for i := range s.shards {
+		shard := &scheduleShard{reset: make(chan struct{}, 1)}
+		s.shards[i] = shard
+
+		s.wg.Add(1)
+		go func() {
+			defer s.wg.Done()
+			shard.run(s.done)
+		}()
+	}
+	return s
+}
+
+// close stops the shards. Loops still waiting are never woken.
+func (s *frameScheduler) close() {
+	close(s.done)
+	s.wg.Wait()
+}
+
+// newClock returns the clock of a send loop. Its timeline starts with the
+// first Wait.
+func (s *frameScheduler) newClock() *frameClock {
+	shard := s.shards[int(s.next.Add(1))%len(s.shards)]
+	return &frameClock{shard: shard, wake: make(chan struct{}, 1), index: -1}
+}
+
+type scheduleShard struct {
+	mu    sync.Mutex
+	queue clockQueue
+	// reset wakes the shard when a clock becomes the earliest.
+	reset chan struct{}
+}
+
+func (s *scheduleShard) run(done <-chan struct{}) {
+	timer := time.NewTimer(time.Hour)
+	defer timer.Stop()
+	for {
+		select {
+		case <-done:
+			return
+		case <-s.reset:
+		case <-timer.C:
+		}
+
+		now := time.Now()
+		s.mu.Lock()
+		for len(s.queue) > 0 && s.queue[0].due.Before(now.Add(scheduleTick)) {
+			c := heap.Pop(&s.queue).(*frameClock)
+			select {
+			case c.wake <- struct{}{}:
+			default:
+			}
+		}
+		next := time.Hour
+		if len(s.queue) > 0 {
+			next = s.queue[0].due.Sub(now)
+		}
+		s.mu.Unlock()
+
+		if !timer.Stop() {
+			select {
+			case <-timer.C:
+			default:
+			}
+		}
+		timer.Reset(next)
+	}
+}
+
+func (s *scheduleShard) add(c *frameClock) {
+	s.mu.Lock()
+	heap.Push(&s.queue, c)
+	earliest := c.index == 0
+	s.mu.Unlock()
+
+	if earliest {
+		select {
+		case s.reset <- struct{}{}:
+		default:
+		}
+	}
+}
+
+func (s *scheduleShard) remove(c *frameClock) {
+	s.mu.Lock()
+	if c.index >= 0 {
+		heap.Remove(&s.queue, c.index)
+	}
+	s.mu.Unlock()
+}
+
+// frameClock paces one send loop along the timeline of its track. The loop
+// passes the presentation time of each frame relative to the first.
+type frameClock struct {
+	shard *scheduleShard
+	wake  chan struct{}
+
+	start time.Time
+	last  time.Duration
+	// due and index are guarded by the shard while queued; index is -1
+	// otherwise.
+	due   time.Time
+	index int
+}
+
+// Wait blocks until the frame at position is due. It returns false if done
+// is closed first; a nil done never is. A loop more than a frame behind is
+// counted as overrun and its timeline moved on instead of bursting the
+// missed frames.
+func (c *frameClock) Wait(position time.Duration, done <-chan struct{}) bool {
+	if c.start.IsZero() {
+		c.start = time.Now()
+	}
+	interval := position - c.last
+	c.last = position
+
+	c.due = c.start.Add(position)
+	if time.Until(c.due) >= scheduleTick {
+		c.shard.add(c)
+		select {
+		case <-c.wake:
+		case <-done:
+			c.shard.remove(c)
+			return false
+		}
+	} else {
+		select {
+		case <-done:
+			return false
+		default:
+		}
+	}
+
+	late := max(time.Since(c.due), 0)
+	frameLateness.Observe(late.Seconds())
+	if interval > 0 {
+		if missed := late / interval; missed > 0 {
+			tickerOverruns.Add(uint64(missed))
+			c.start = c.start.Add(late)
+		}
+	}
+	return true
+}
+
+// clockQueue is a min-heap of clocks by due time.
+type clockQueue []*frameClock
+
+func (q clockQueue) Len() int           { return len(q) }
+func (q clockQueue) Less(i, j int) bool { return q[i].due.Before(q[j].due) }
+
+func (q clockQueue) Swap(i, j int) {
+	q[i], q[j] = q[j], q[i]
+	q[i].index = i
+	q[j].index = j
+}
+
+func (q *clockQueue) Push(x any) {
+	c := x.(*frameClock)
+	c.index = len(*q)
+	*q = append(*q, c)
+}
+
+func (q *clockQueue) Pop() any {
+	old := *q
+	c := old[len(old)-1]
+	old[len(old)-1] = nil
+	c.index = -1
+	*q = old[:len(old)-1]
+	return c
+}
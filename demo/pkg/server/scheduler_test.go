@@ -0,0 +1,60 @@
+package server
+
+import (
+	"testing"
+	"time"
+)
+
+// TestClockPaces checks that a clock wakes at the positions of its frames
+// and returns once done is closed.
+func TestClockPaces(t *testing.T) {
+	s := newFrameScheduler()
+	defer s.close()
+
+	const interval = 20 * time.Millisecond
+	clock := s.newClock()
+	start := time.Now()
+	for i := 0; i < 5; i++ {
+		if !clock.Wait(time.Duration(i)*interval, nil) {
+			t.Fatal("wait without done failed")
+		}
+		if elapsed := time.Since(start); elapsed < time.Duration(i)*interval-scheduleTick {
+			t.Fatalf("frame %d woke after %v", i, elapsed)
+		}
+	}
+	if elapsed := time.Since(start); elapsed > 4*interval+50*time.Millisecond {
+		t.Fatalf("five frames took %v", elapsed)
+	}
+
+	done := make(chan struct{})
+	go func() {
+		time.Sleep(interval)
+		close(done)
+	}()
+	if clock.Wait(time.Hour, done) {
+		t.Fatal("wait returned true after done")
+	}
+}
+
+// TestClocksWakeInOrder checks that clocks of one shard wake by due time.
+func TestClocksWakeInOrder(t *testing.T) {
+	s := newFrameScheduler()
+	defer s.close()
+
+	woken := make(chan int, 3)
+	for i, delay := range []time.Duration{30, 10, 20} {
+		i, delay := i, delay
+		clock := s.newClock()
+		clock.shard = s.shards[0]
+		go func() {
+			clock.Wait(0, nil)
+			clock.Wait(delay*time.Millisecond, nil)
+			woken <- i
+		}()
+	}
+	for _, want := range []int{1, 2, 0} {
+		if got := <-woken; got != want {
+			t.Fatalf("clock %d woke, want %d", got, want)
+		}
+	}
+}
@@ -0,0 +1,230 @@
+package server
+
+import (
+	"bwe/demo/pkg/attr"
+	"context"
+	"encoding/json"
+	"log/slog"
+	"net/http"
+	"slices"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"github.com/pion/webrtc/v4"
+)
+
+// sessionMode selects what a session is sent.
+type sessionMode int
+
+const (
+	modeFull sessionMode = iota
+	// modeLowest sends only the cheapest rendition.
+	modeLowest
+	// modeRelay sends every rendition at full rate to an edge.
+	modeRelay
+)
+
+func (m sessionMode) String() string {
+	switch m {
+	case modeLowest:
+		return "lowest"
+	case modeRelay:
+		return "relay"
+	default:
+		return "full"
+	}
+}
+
+// Session owns a viewer's peer connection and every goroutine started for
+// it. It is cancelled when the websocket closes or the peer connection fails,
+// and close returns only after the goroutines have exited.
+type Session struct {
+	ID      int
+	Started time.Time
+
+	// log carries the session ID; track loops derive theirs from it.
+	log *slog.Logger
+
+	pc   PeerConnection
+	ctx  context.Context
+	mode sessionMode
+
+	// tracks are the per-session tracks renegotiation can change when
+	// selectable. Both belong to the signaling goroutine.
+	tracks     []*sessionTrack
+	selectable bool
+
+	cancel    context.CancelFunc
+	connected chan struct{}
+	connect   sync.Once
+	state     atomic.Value
+	wg        sync.WaitGroup
+}
+
+func newSession(pc PeerConnection, mode sessionMode) *Session {
+	ctx, cancel := context.WithCancel(context.Background())
+	id := int(sessionIDs.Add(1))
+	s := &Session{
+		ID:        id,
+		Started:   time.Now(),
+		log:       slog.With(attr.Session(id)),
+		pc:        pc,
+		ctx:       ctx,
+		mode:      mode,
+		cancel:    cancel,
+		connected: make(chan struct{}),
+	}
+	s.state.Store(webrtc.PeerConnectionStateNew)
+	return s
+}
+
+// Go runs f on a goroutine that close waits for. f must return once the
+// session context is done or the peer connection is closed.
+func (s *Session) Go(f func()) {
+	s.wg.Add(1)
+	go func() {
+		defer s.wg.Done()
+		f()
+	}()
+}
+
+// Cancel ends the session without waiting for it to be torn down.
+func (s *Session) Cancel() {
+	s.cancel()
+}
+
+func (s *Session) Done() <-chan struct{} {
+	return s.ctx.Done()
+}
+
+func (s *Session) setConnected() {
+	s.connect.Do(func() { close(s.connected) })
+}
+
+// waitConnected blocks until ICE connects. It returns false if the session
+// ended first.
+func (s *Session) waitConnected() bool {
+	select {
+	case <-s.connected:
+		return s.ctx.Err() == nil
+	case <-s.ctx.Done():
+		return false
+	}
+}
+
+func (s *Session) setState(state webrtc.PeerConnectionState) {
+	s.state.Store(state)
+	if state == webrtc.PeerConnectionStateFailed || state == webrtc.PeerConnectionStateClosed {
+		s.cancel()
+	}
+}
+
+// close cancels the session, closes the peer connection, which unblocks the
+// RTCP readers, and waits for the session goroutines.
+func (s *Session) close() {
+	s.cancel()
+
+	err := s.pc.Close()
+	if err != nil {
+		s.log.Error("close peer connection", attr.Error(err))
+	}
+
+	s.wg.Wait()
+
+	if s.pc.Pacer != nil {
+		s.log.Info("session pacer stats", attr.PacerStats(s.pc.Pacer.Stats()))
+	}
+}
+
+// SessionInfo describes a live session.
+type SessionInfo struct {
+	ID       int       `json:"id"`
+	Started  time.Time `json:"started"`
+	Duration string    `json:"duration"`
+	State    string    `json:"state"`
+	Senders  int       `json:"senders"`
+	Mode     string    `json:"mode"`
+}
+
+// Sessions is the registry of live sessions. It serves them as JSON.
+type Sessions struct {
+	mu       sync.Mutex
+	sessions map[int]*Session
+	live     sync.WaitGroup
+}
+
+func NewSessions() *Sessions {
+	return &Sessions{sessions: map[int]*Session{}}
+}
+
+func (r *Sessions) add(s *Session) {
+	r.mu.Lock()
+	r.sessions[s.ID] = s
+	r.mu.Unlock()
+	r.live.Add(1)
+	sessionsTotal.Inc()
+	sessionsActive.Inc()
+}
+
+func (r *Sessions) remove(s *Session) {
+	r.mu.Lock()
+	delete(r.sessions, s.ID)
+	r.mu.Unlock()
+	r.live.Done()
+	sessionsActive.Dec()
+}
+
+// List returns the live sessions ordered by ID.
+func (r *Sessions) List() []SessionInfo {
+	r.mu.Lock()
+	defer r.mu.Unlock()
+
+	now := time.Now()
+	infos := make([]SessionInfo, 0, len(r.sessions))
+	for _, s := range r.sessions {
+		infos = append(infos, SessionInfo{
+			ID:       s.ID,
+			Started:  s.Started,
+			Duration: now.Sub(s.Started).Round(time.Millisecond).String(),
+			State:    s.state.Load().(webrtc.PeerConnectionState).String(),
+			Senders:  len(s.pc.Feedback.snapshot()),
+			Mode:     s.mode.String(),
+		})
+	}
+	slices.SortFunc(infos, func(a, b SessionInfo) int { return a.ID - b.ID })
+	return infos
+}
+
+// pacerQueued sums the packets queued in the pacers of live sessions.
+func (r *Sessions) pacerQueued() int {
+	r.mu.Lock()
+	defer r.mu.Unlock()
+
+	queued := 0
+	for _, s := range r.sessions {
+		if s.pc.Pacer != nil {
+			queued += s.pc.Pacer.Stats().Queued
+		}
+	}
+	return queued
+}
+
+// Close cancels every live session and waits until they are torn down.
+func (r *Sessions) Close() {
+	r.mu.Lock()
+	for _, s := range r.sessions {
+		s.Cancel()
+	}
+	r.mu.Unlock()
+
+	r.live.Wait()
+}
+
+func (r *Sessions) ServeHTTP(w http.ResponseWriter, _ *http.Request) {
+	w.Header().Set("Content-Type", "application/json")
+	err := json.NewEncoder(w).Encode(r.List())
+	if err != nil {
+		slog.Error("encode sessions", attr.Error(err))
+	}
+}
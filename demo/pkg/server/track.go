@@ -0,0 +1,131 @@
+package server
+
+import (
+	"bwe/demo/pkg/framestore"
+	"bwe/demo/pkg/rtpcache"
+	"fmt"
+	"math/rand"
+	"time"
+
+	"github.com/pion/rtp"
+	"github.com/pion/webrtc/v4"
+	"github.com/pion/webrtc/v4/pkg/media"
+)
+
+// frameTrack is a session track that sends frames of the given videos.
+type frameTrack interface {
+	webrtc.TrackLocal
+	// writeFrame sends the i-th frame of video presented at position on the
+	// track timeline and returns its size.
+	writeFrame(video *framestore.Video, i int, position time.Duration) (int, error)
+}
+
+// newTrack returns a track for the videos, which must share a codec. With
+// the RTP cache the track sends the cached payloads, otherwise it runs the
+// payloader on every frame.
+func (h Handler) newTrack(videos ...*framestore.Video) (frameTrack, error) {
+	if h.Packets == nil {
+		track, err := newVideoTrack(videos[0].Header)
+		if err != nil {
+			return nil, err
+		}
+		return sampleTrack{track}, nil
+	}
+
+	return newPacketTrack(h.Packets, videos)
+}
+
+type sampleTrack struct {
+	*webrtc.TrackLocalStaticSample
+}
+
+// writeFrame advances the sample timestamps by the frame duration, which
+// follows the position on the timeline as long as frames are not skipped.
+func (t sampleTrack) writeFrame(video *framestore.Video, i int, _ time.Duration) (int, error) {
+	frame := video.Frame(i)
+	return len(frame), t.WriteSample(media.Sample{Data: frame, Duration: video.FrameDuration(i)})
+}
+
+// packetTrack sends payloads from the RTP cache. Only the sequence number,
+// timestamp and marker of a single reused packet change per write; the
+// payloads are shared by every session. VP8 and VP9 payloads are copied to
+// number the frames with the picture IDs of the track. The track keeps only
+// the video it sends, so payloads of replaced versions are freed with them.
+type packetTrack struct {
+	*webrtc.TrackLocalStaticRTP
+	cache   *rtpcache.Store
+	video   *framestore.Video
+	packets *rtpcache.Video
+
+	packet    rtp.Packet
+	timestamp uint32
+	pictureID uint16
+	payload   []byte
+}
+
+func newPacketTrack(cache *rtpcache.Store, videos []*framestore.Video) (*packetTrack, error) {
+	mimeType, err := mimeType(videos[0].Header.FourCC)
+	if err != nil {
+		return nil, err
+	}
+
+	track, err := webrtc.NewTrackLocalStaticRTP(webrtc.RTPCodecCapability{MimeType: mimeType}, "video", "pion")
+	if err != nil {
+		return nil, fmt.Errorf("new track local: %w", err)
+	}
+
+	t := &packetTrack{
+		TrackLocalStaticRTP: track,
+		cache:               cache,
+		timestamp:           rand.Uint32(),
+		pictureID:           uint16(rand.Uint32()) & 0x7fff,
+	}
+	t.packet.Version = 2
+	t.packet.SequenceNumber = uint16(rand.Uint32())
+
+	// Packetizing up front surfaces errors before the session starts.
+	for _, video := range videos {
+		if _, err := cache.Get(video); err != nil {
+			return nil, fmt.Errorf("packetize %s: %w", video.Path, err)
+		}
+	}
+
+	return t, nil
+}
+
+// writeFrame stamps the frame by its position on the track timeline, so
+// timestamps keep increasing across loops and switches between videos of
+// the track.
+func (t *packetTrack) writeFrame(video *framestore.Video, i int, position time.Duration) (int, error) {
+	if video != t.video {
+		packets, err := t.cache.Get(video)
+		if err != nil {
+			return 0, fmt.Errorf("packetize %s: %w", video.Path, err)
+		}
+		t.video, t.packets = video, packets
+	}
+	payloads := t.packets.Payloads(i)
+
+	size := 0
+	// Microseconds keep the product within int64 for years of playback;
+	// nanoseconds overflow after about 28 hours.
+	t.packet.Timestamp = t.timestamp + uint32(int64(position/time.Microsecond)*rtpcache.ClockRate/int64(time.Second/time.Microsecond))
+	pictureID := rtpcache.HasPictureID(video.Header.FourCC)
+	for j, payload := range payloads {
+		t.packet.Marker = j == len(payloads)-1
+		t.packet.Payload = payload
+		if pictureID {
+			t.payload = rtpcache.AppendPictureID(t.payload[:0], video.Header.FourCC, payload, t.pictureID)
+			t.packet.Payload = t.payload
+		}
+		err := t.WriteRTP(&t.packet)
+		t.packet.SequenceNumber++
+		if err != nil {
+			return size, err
+		}
+		size += len(payload)
+	}
+	t.pictureID = (t.pictureID + 1) & 0x7fff
+
+	return size, nil
+}
@@ -0,0 +1,93 @@
+package server
+
+import (
+	"crypto/ecdsa"
+	"crypto/elliptic"
+	"crypto/rand"
+	"fmt"
+	"net"
+	"strings"
+	"sync"
+	"time"
+
+	"github.com/pion/dtls/v2"
+	"github.com/pion/logging"
+	"github.com/pion/webrtc/v4"
+)
+
+var srtpProfiles = map[string]dtls.SRTPProtectionProfile{
+	"aead_aes_128_gcm":       dtls.SRTP_AEAD_AES_128_GCM,
+	"aead_aes_256_gcm":       dtls.SRTP_AEAD_AES_256_GCM,
+	"aes128_cm_hmac_sha1_80": dtls.SRTP_AES128_CM_HMAC_SHA1_80,
+	"aes128_cm_hmac_sha1_32": dtls.SRTP_AES128_CM_HMAC_SHA1_32,
+}
+
+// configureTransport applies the shared ICE muxes and the SRTP profile order
+// to the setting engine.
+func configureTransport(se *webrtc.SettingEngine, config TransportConfig, loggerFactory logging.LoggerFactory) error {
+	var networkTypes []webrtc.NetworkType
+
+	if config.UDPPort != 0 {
+		udpConn, err := net.ListenUDP("udp", &net.UDPAddr{Port: config.UDPPort})
+		if err != nil {
+			return fmt.Errorf("listen udp: %w", err)
+		}
+		se.SetICEUDPMux(webrtc.NewICEUDPMux(loggerFactory.NewLogger("ice-udp-mux"), udpConn))
+		networkTypes = append(networkTypes, webrtc.NetworkTypeUDP4, webrtc.NetworkTypeUDP6)
+	}
+
+	if config.TCPPort != 0 {
+		tcpListener, err := net.ListenTCP("tcp", &net.TCPAddr{Port: config.TCPPort})
+		if err != nil {
+			return fmt.Errorf("listen tcp: %w", err)
+		}
+		se.SetICETCPMux(webrtc.NewICETCPMux(loggerFactory.NewLogger("ice-tcp-mux"), tcpListener, 8))
+		networkTypes = append(networkTypes, webrtc.NetworkTypeTCP4, webrtc.NetworkTypeTCP6)
+	}
+
+	if len(networkTypes) > 0 {
+		se.SetNetworkTypes(networkTypes)
+	}
+
+	if len(config.SRTPProfiles) > 0 {
+		profiles := make([]dtls.SRTPProtectionProfile, 0, len(config.SRTPProfiles))
+		for _, name := range config.SRTPProfiles {
+			profile, ok := srtpProfiles[strings.ToLower(name)]
+			if !ok {
+				return fmt.Errorf("unknown srtp profile %s", name)
+			}
+			profiles = append(profiles, profile)
+		}
+		se.SetSRTPProtectionProfiles(profiles...)
+	}
+
+	return nil
+}
+
+// certificateCache hands out one DTLS certificate to every connection and
+// replaces it shortly before it expires.
+type certificateCache struct {
+	mu          sync.Mutex
+	certificate *webrtc.Certificate
+}
+
+const certificateRenewBefore = 24 * time.Hour
+
+func (c *certificateCache) Get() (webrtc.Certificate, error) {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+
+	if c.certificate == nil || time.Until(c.certificate.Expires()) < certificateRenewBefore {
+		key, err := ecdsa.GenerateKey(elliptic.P256(), rand.Reader)
+		if err != nil {
+			return webrtc.Certificate{}, fmt.Errorf("generate key: %w", err)
+		}
+
+		c.certificate, err = webrtc.GenerateCertificate(key)
+		if err != nil {
+			return webrtc.Certificate{}, fmt.Errorf("generate certificate: %w", err)
+		}
+	}
+
+	return *c.certificate, nil
+}
@@ -0,0 +1,70 @@
+package signal
+
+import (
+	"log/slog"
+	"sync"
+	"time"
+)
+
+// SetupTimer records when each stage of session setup completed, relative
+// to the start of the session.
+type SetupTimer struct {
+	start  time.Time
+	logger *slog.Logger
+
+	mu     sync.Mutex
+	stages []slog.Attr
+	logged bool
+}
+
+func NewSetupTimer(logger *slog.Logger) *SetupTimer {
+	return &SetupTimer{start: time.Now(), logger: logger}
+}
+
+// Mark records that the stage completed now. Repeated marks are ignored.
+func (t *SetupTimer) Mark(stage string) {
+	t.mu.Lock()
+	defer t.mu.Unlock()
+	t.mark(stage)
+}
+
+// Log marks the final stage and logs the breakdown once.
+func (t *SetupTimer) Log(stage string) {
+	t.mu.Lock()
+	defer t.mu.Unlock()
+	if t.logged {
+		return
+	}
+	t.mark(stage)
+	t.logged = true
+
+	stages := make([]any, len(t.stages))
+	for i, stage := range t.stages {
+		stages[i] = stage
+	}
+	t.logger.Info("session setup", slog.Group("setup", stages...))
+}
+
+// Stage returns when the stage completed, if it did.
+func (t *SetupTimer) Stage(stage string) (time.Duration, bool) {
+	t.mu.Lock()
+	defer t.mu.Unlock()
+	for _, s := range t.stages {
+		if s.Key == stage {
+			return s.Value.Duration(), true
+		}
+	}
+	return 0, false
+}
+
+func (t *SetupTimer) mark(stage string) {
+	if t.logged {
+		return
+	}
+	for _, s := range t.stages {
+		if s.Key == stage {
+			return
+		}
+	}
+	t.stages = append(t.stages, slog.Duration(stage, time.Since(t.start)))
+}
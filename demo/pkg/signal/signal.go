@@ -0,0 +1,173 @@
+// Package signal defines the websocket protocol between the demo server and
+// its clients. Descriptions are sent as soon as they are set and ICE
+// candidates trickle in both directions afterwards. The server is always
+// the offerer: a client changes a live session by asking for a new offer,
+// which it answers like the first one, on the same peer connection.
+package signal
+
+import (
+	"encoding/json"
+	"fmt"
+	"sync"
+	"time"
+
+	"github.com/pion/webrtc/v4"
+	"golang.org/x/net/websocket"
+)
+
+const (
+	TypeOffer     = "offer"
+	TypeAnswer    = "answer"
+	TypeCandidate = "candidate"
+	// TypeError is sent by the server instead of an offer when it refuses
+	// the session. The websocket is closed right after. During a session
+	// it refuses a renegotiation, which leaves the session as it was.
+	TypeError = "error"
+	// TypeRenegotiate asks the server for a new offer, restarting ICE or
+	// changing the received videos.
+	TypeRenegotiate = "renegotiate"
+	// TypeStats uploads a batch of receiver stats of a browser.
+	TypeStats = "stats"
+)
+
+// Message is a single signaling message. Descriptions keep the JSON layout
+// of webrtc.SessionDescription, so browsers can pass them on as is.
+type Message struct {
+	Type      string                   `json:"type"`
+	SDP       string                   `json:"sdp,omitempty"`
+	Candidate *webrtc.ICECandidateInit `json:"candidate,omitempty"`
+	Error     string                   `json:"error,omitempty"`
+
+	// ICERestart and Videos are set on renegotiate messages. Videos indexes
+	// the videos of the server to receive; empty keeps the current ones.
+	ICERestart bool  `json:"ice_restart,omitempty"`
+	Videos     []int `json:"videos,omitempty"`
+
+	// StatsInterval, in milliseconds, is set on offers when the server
+	// collects browser stats, which are then uploaded as Stats records
+	// in the StreamStats layout of the Go client.
+	StatsInterval int64           `json:"stats_interval,omitempty"`
+	Stats         json.RawMessage `json:"stats,omitempty"`
+}
+
+// SessionDescription converts an offer or answer message.
+func (m Message) SessionDescription() webrtc.SessionDescription {
+	return webrtc.SessionDescription{Type: webrtc.NewSDPType(m.Type), SDP: m.SDP}
+}
+
+// Conn sends signaling messages over a websocket. Local candidates gathered
+// before the description is sent are held back, since the remote side cannot
+// apply them earlier.
+type Conn struct {
+	ws *websocket.Conn
+
+	mu        sync.Mutex
+	described bool
+	pending   []webrtc.ICECandidateInit
+}
+
+func NewConn(ws *websocket.Conn) *Conn {
+	return &Conn{ws: ws}
+}
+
+// HoldCandidates holds back local candidates again until the next
+// description is sent. Renegotiations call it before setting the local
+// description, since candidates of an ICE restart belong to the new
+// credentials the remote side only learns from that description.
+func (c *Conn) HoldCandidates() {
+	c.mu.Lock()
+	c.described = false
+	c.mu.Unlock()
+}
+
+// SendDescription sends the description followed by held back candidates.
+func (c *Conn) SendDescription(desc webrtc.SessionDescription) error {
+	return c.sendDescription(Message{Type: desc.Type.String(), SDP: desc.SDP})
+}
+
+// SendOffer sends an offer that asks the remote side to upload its stats
+// every statsInterval, or not at all if it is zero.
+func (c *Conn) SendOffer(desc webrtc.SessionDescription, statsInterval time.Duration) error {
+	return c.sendDescription(Message{Type: desc.Type.String(), SDP: desc.SDP, StatsInterval: statsInterval.Milliseconds()})
+}
+
+func (c *Conn) sendDescription(message Message) error {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+
+	err := websocket.JSON.Send(c.ws, message)
+	if err != nil {
+		return fmt.Errorf("send description: %w", err)
+	}
+	c.described = true
+
+	for i := range c.pending {
+		err = websocket.JSON.Send(c.ws, Message{Type: TypeCandidate, Candidate: &c.pending[i]})
+		if err != nil {
+			return fmt.Errorf("send candidate: %w", err)
+		}
+	}
+	c.pending = nil
+
+	return nil
+}
+
+// SendCandidate sends a local candidate. The nil candidate that ends
+// gathering is not sent.
+func (c *Conn) SendCandidate(candidate *webrtc.ICECandidate) error {
+	if candidate == nil {
+		return nil
+	}
+	init := candidate.ToJSON()
+
+	c.mu.Lock()
+	defer c.mu.Unlock()
+
+	if !c.described {
+		c.pending = append(c.pending, init)
+		return nil
+	}
+
+	err := websocket.JSON.Send(c.ws, Message{Type: TypeCandidate, Candidate: &init})
+	if err != nil {
+		return fmt.Errorf("send candidate: %w", err)
+	}
+
+	return nil
+}
+
+// SendError tells the remote side why the session is refused.
+func (c *Conn) SendError(reason string) error {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+
+	err := websocket.JSON.Send(c.ws, Message{Type: TypeError, Error: reason})
+	if err != nil {
+		return fmt.Errorf("send error: %w", err)
+	}
+	return nil
+}
+
+// SendRenegotiate asks the server for a new offer.
+func (c *Conn) SendRenegotiate(iceRestart bool, videos []int) error {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+
+	err := websocket.JSON.Send(c.ws, Message{Type: TypeRenegotiate, ICERestart: iceRestart, Videos: videos})
+	if err != nil {
+		return fmt.Errorf("send renegotiate: %w", err)
+	}
+	return nil
+}
+
+// Receive blocks until the next message arrives.
+func (c *Conn) Receive() (Message, error) {
+	var m Message
+	err := websocket.JSON.Receive(c.ws, &m)
+	return m, err
+}
+
+// Close closes the underlying websocket.
+func (c *Conn) Close() error {
+	return c.ws.Close()
+}
@@ -0,0 +1,190 @@
+// Package trace records per-packet receive events. Each track fills
+// preallocated chunks without allocating; full chunks are encoded and
+// written by a background goroutine.
+package trace
+
+import (
+	"bwe/demo/pkg/report"
+	"encoding/binary"
+	"sync"
+	"sync/atomic"
+	"time"
+)
+
+// Packet is a received RTP packet.
+type Packet struct {
+	Arrival        int64
+	Session        uint32
+	SSRC           uint32
+	Timestamp      uint32
+	SequenceNumber uint16
+	Size           uint16
+	Marker         bool
+	PayloadType    uint8
+}
+
+// Schema lists the Packet fields in the order they are encoded.
+var Schema = []report.Field{
+	{Name: "arrival", Type: "<i8"},
+	{Name: "session", Type: "<u4"},
+	{Name: "ssrc", Type: "<u4"},
+	{Name: "timestamp", Type: "<u4"},
+	{Name: "sequence_number", Type: "<u2"},
+	{Name: "size", Type: "<u2"},
+	{Name: "marker", Type: "<u1"},
+	{Name: "payload_type", Type: "<u1"},
+}
+
+const packetSize = 8 + 4 + 4 + 4 + 2 + 2 + 1 + 1
+
+func (p Packet) appendBinary(b []byte) []byte {
+	b = report.AppendInt64(b, p.Arrival)
+	b = report.AppendUint32(b, p.Session)
+	b = report.AppendUint32(b, p.SSRC)
+	b = report.AppendUint32(b, p.Timestamp)
+	b = report.AppendUint16(b, p.SequenceNumber)
+	b = report.AppendUint16(b, p.Size)
+	var marker uint8
+	if p.Marker {
+		marker = 1
+	}
+	b = report.AppendUint8(b, marker)
+	b = report.AppendUint8(b, p.PayloadType)
+	return b
+}
+
+// Parse reads the fixed RTP header fields of a raw packet.
+func Parse(raw []byte, arrival time.Time) (Packet, bool) {
+	const headerSize = 12
+	if len(raw) < headerSize {
+		return Packet{}, false
+	}
+
+	return Packet{
+		Arrival:        arrival.UnixNano(),
+		Marker:         raw[1]&0x80 != 0,
+		PayloadType:    raw[1] & 0x7f,
+		SequenceNumber: binary.BigEndian.Uint16(raw[2:4]),
+		Timestamp:      binary.BigEndian.Uint32(raw[4:8]),
+		SSRC:           binary.BigEndian.Uint32(raw[8:12]),
+		Size:           uint16(min(len(raw), 0xffff)),
+	}, true
+}
+
+type chunk struct {
+	packets []Packet
+}
+
+// Writer owns a fixed set of chunks. Recorders take free chunks and hand
+// full ones back for writing.
+type Writer struct {
+	report *report.Writer
+	free   chan *chunk
+	full   chan *chunk
+
+	dropped   atomic.Uint64
+	recorders sync.WaitGroup
+	wg        sync.WaitGroup
+}
+
+// NewWriter preallocates chunks chunks of chunkSize packets each. The
+// report must use FormatBinary with Schema.
+func NewWriter(w *report.Writer, chunkSize, chunks int) *Writer {
+	chunkSize = max(chunkSize, 1)
+	chunks = max(chunks, 2)
+
+	t := &Writer{
+		report: w,
+		free:   make(chan *chunk, chunks),
+		full:   make(chan *chunk, chunks),
+	}
+	for i := 0; i < chunks; i++ {
+		t.free <- &chunk{packets: make([]Packet, 0, chunkSize)}
+	}
+
+	t.wg.Add(1)
+	go t.run()
+
+	return t
+}
+
+func (t *Writer) run() {
+	defer t.wg.Done()
+
+	var buf []byte
+	for c := range t.full {
+		buf = buf[:0]
+		for _, p := range c.packets {
+			buf = p.appendBinary(buf)
+		}
+		if err := t.report.WriteBinary(buf); err != nil {
+			t.dropped.Add(uint64(len(c.packets)))
+		}
+
+		c.packets = c.packets[:0]
+		t.free <- c
+	}
+}
+
+// Dropped returns the number of packets lost because no chunk was free or
+// the report could not be written.
+func (t *Writer) Dropped() uint64 {
+	return t.dropped.Load()
+}
+
+// Close waits for all recorders to close, writes their chunks and closes
+// the report.
+func (t *Writer) Close() error {
+	t.recorders.Wait()
+	close(t.full)
+	t.wg.Wait()
+	return t.report.Close()
+}
+
+// Recorder captures the packets of one track. It is not safe for
+// concurrent use.
+type Recorder struct {
+	writer  *Writer
+	session uint32
+	chunk   *chunk
+}
+
+func (t *Writer) NewRecorder(session int) *Recorder {
+	t.recorders.Add(1)
+	return &Recorder{writer: t, session: uint32(session)}
+}
+
+// Record appends the packet to the current chunk.
+func (r *Recorder) Record(p Packet) {
+	if r.chunk == nil {
+		select {
+		case r.chunk = <-r.writer.free:
+		default:
+			r.writer.dropped.Add(1)
+			return
+		}
+	}
+
+	p.Session = r.session
+	r.chunk.packets = append(r.chunk.packets, p)
+	if len(r.chunk.packets) == cap(r.chunk.packets) {
+		r.writer.full <- r.chunk
+		r.chunk = nil
+	}
+}
+
+// Close submits the partially filled chunk.
+func (r *Recorder) Close() {
+	defer r.writer.recorders.Done()
+
+	if r.chunk == nil {
+		return
+	}
+
+	if len(r.chunk.packets) > 0 {
+		r.writer.full <- r.chunk
+	} else {
+		r.writer.free <- r.chunk
+	}
+	r.chunk = nil
+}
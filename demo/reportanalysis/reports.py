@@ -0,0 +1,62 @@
+"""Loaders for the stats reports written by the demo client and server."""
+
+import json
+
+import numpy as np
+import pandas as pd
+
+MAGIC = b"BWESTATS"
+
+
+def load_report(path):
+    """Load a JSON lines or binary report into a DataFrame.
+
+    The metadata the report was written with, such as the interceptor
+    pipeline, is returned in the attrs["meta"] of the frame.
+    """
+    with open(path, "rb") as f:
+        if f.read(len(MAGIC)) != MAGIC:
+            return _load_json_report(path)
+
+        header_size = int.from_bytes(f.read(4), "little")
+        header = json.loads(f.read(header_size))
+        dtype = np.dtype([tuple(field) for field in header["fields"]])
+        data = f.read()
+
+    # A report that is still being written may end in a partial record.
+    records = np.frombuffer(data, dtype=dtype, count=len(data) // dtype.itemsize)
+    frame = pd.DataFrame(records)
+    frame.attrs["meta"] = header.get("meta", {})
+    return frame
+
+
+def _load_json_report(path):
+    meta = {}
+    with open(path) as f:
+        first = f.readline()
+        if first.startswith('{"meta":'):
+            meta = json.loads(first)["meta"]
+        else:
+            f.seek(0)
+        frame = pd.read_json(f, lines=True)
+    frame.attrs["meta"] = meta
+    return frame
+
+
+def join_sessions(client, server, tolerance="1s"):
+    """Match every client sample with the latest server sample of its SSRC.
+
+    Session ids are assigned independently on both sides, the SSRC chosen by
+    the server identifies the stream in both reports.
+    """
+    client = client.assign(time=pd.to_datetime(client["timestamp"], unit="ns")).sort_values("time")
+    server = server.assign(time=pd.to_datetime(server["timestamp"], unit="ns")).sort_values("time")
+    return pd.merge_asof(
+        client,
+        server.drop(columns=["timestamp"]),
+        on="time",
+        by="ssrc",
+        suffixes=("", "_server"),
+        tolerance=pd.Timedelta(tolerance),
+        direction="backward",
+    )
@@ -5,6 +5,8 @@ const pc = new RTCPeerConnection({
         urls: 'stun:stun.l.google.com:19302'
     }]
 })
+const created = performance.now()
+let firstFrame = 0
 
 pc.ontrack = function (event) {
     const el = document.createElement(event.track.kind)
@@ -12,31 +14,164 @@ pc.ontrack = function (event) {
     el.autoplay = true
     el.muted = true
     el.controls = true
+    el.addEventListener('loadeddata', () => {
+        firstFrame = firstFrame || performance.now()
+    }, {once: true})
 
     document.getElementById('remoteVideos').appendChild(el)
 }
 
-const offerReadyPromise = new Promise((resolve, reject) => {
-    pc.onicecandidate = event => {
-        if (event.candidate == null) {
-            resolve()
-        }
+const socket = new WebSocket("ws://" + window.location.hostname + "/watch");
+
+// Candidates gathered before the answer is sent are held back, the server
+// cannot apply them without a remote description.
+let answerSent = false
+const pendingCandidates = []
+
+const sendCandidate = candidate => {
+    socket.send(JSON.stringify({type: 'candidate', candidate: candidate}))
+}
+
+pc.onicecandidate = event => {
+    if (event.candidate == null) {
+        return
+    }
+
+    const candidate = event.candidate.toJSON()
+    if (answerSent) {
+        sendCandidate(candidate)
+    } else {
+        pendingCandidates.push(candidate)
+    }
+}
+
+socket.addEventListener("message", (event) => {
+    const message = JSON.parse(event.data)
+
+    if (message.type === 'candidate') {
+        pc.addIceCandidate(message.candidate)
+        return
+    }
+    if (message.type === 'error') {
+        console.warn('signaling error', message.error)
+        return
     }
+    if (message.stats_interval) {
+        collectStats(message.stats_interval)
+    }
+
+    // Candidates of an ICE restart wait for the answer that carries the
+    // new credentials, like those of the first answer.
+    answerSent = false
+    pc.setRemoteDescription(message)
+        .then(() => pc.createAnswer())
+        .then(d => pc.setLocalDescription(d))
+        .then(() => {
+            socket.send(JSON.stringify(pc.localDescription))
+            answerSent = true
+            pendingCandidates.splice(0).forEach(sendCandidate)
+        })
 })
 
-const socket = new WebSocket("ws://" + window.location.hostname + "/watch");
-const socketOpenPromise = new Promise((resolve, reject) => {
-    socket.onopen = event => {
-        resolve()
+// A network change or disconnected ICE asks the server for an offer with an ICE
+// restart, which keeps the peer connection and its DTLS session. Failed
+// ICE ends the session on the server, so it is too late by then.
+const restartIce = () => {
+    if (answerSent && socket.readyState === WebSocket.OPEN) {
+        socket.send(JSON.stringify({type: 'renegotiate', ice_restart: true}))
     }
-});
+}
 
-Promise.all([offerReadyPromise, socketOpenPromise]).then(value => {
-    socket.send(JSON.stringify(pc.localDescription))
+window.addEventListener('online', restartIce)
+if (navigator.connection) {
+    navigator.connection.addEventListener('change', restartIce)
+}
+pc.addEventListener('iceconnectionstatechange', () => {
+    if (pc.iceConnectionState === 'disconnected') {
+        restartIce()
+    }
 })
 
-socket.addEventListener("message", (event) => {
-    pc.setRemoteDescription(JSON.parse(event.data)).then(ev => {
-        pc.createAnswer().then(d => pc.setLocalDescription(d))
+// Stats are polled every interval the server asked for on its offer and
+// uploaded in batches in the StreamStats layout of the Go client, so both
+// land in the same kind of report. Times are converted to nanoseconds and
+// seconds like there.
+const statsBatch = 5
+// While the socket cannot send, at most statsBacklog records are kept, the
+// oldest are dropped.
+const statsBacklog = 20 * statsBatch
+let statsTimer = null
+const lastTarget = new Map()
+
+const streamStats = (report, now) => {
+    const last = lastTarget.get(report.ssrc) || {delay: 0, count: 0}
+    const count = report.jitterBufferEmittedCount || 0
+    const delay = report.jitterBufferTargetDelay || 0
+    lastTarget.set(report.ssrc, {delay: delay, count: count})
+
+    return {
+        timestamp: Math.round(now * 1e6),
+        ssrc: report.ssrc,
+        packets_received: report.packetsReceived || 0,
+        packets_lost: report.packetsLost || 0,
+        jitter: report.jitter || 0,
+        last_packet_received_timestamp: Math.round((report.lastPacketReceivedTimestamp || 0) * 1e6),
+        header_bytes_received: report.headerBytesReceived || 0,
+        bytes_received: report.bytesReceived || 0,
+        fir_count: report.firCount || 0,
+        pli_count: report.pliCount || 0,
+        nack_count: report.nackCount || 0,
+        frames_rendered: report.framesDecoded || 0,
+        frames_dropped: report.framesDropped || 0,
+        freeze_count: report.freezeCount || 0,
+        total_freezes_duration: report.totalFreezesDuration || 0,
+        jitter_buffer_delay: report.jitterBufferDelay || 0,
+        jitter_buffer_target: count > last.count ? (delay - last.delay) / (count - last.count) : 0,
+        time_to_first_frame: firstFrame ? (firstFrame - created) / 1000 : 0
+    }
+}
+
+const collectStats = interval => {
+    if (statsTimer !== null) {
+        return
+    }
+
+    let pending = []
+    const flush = () => {
+        if (pending.length === 0 || socket.readyState !== WebSocket.OPEN) {
+            return
+        }
+        socket.send(JSON.stringify({type: 'stats', stats: pending}))
+        pending = []
+    }
+
+    statsTimer = setInterval(() => {
+        pc.getStats().then(reports => {
+            const now = performance.timeOrigin + performance.now()
+            reports.forEach(report => {
+                if (report.type === 'inbound-rtp' && report.kind === 'video') {
+                    pending.push(streamStats(report, now))
+                }
+            })
+            if (pending.length > statsBacklog) {
+                pending.splice(0, pending.length - statsBacklog)
+            }
+            if (pending.length >= statsBatch) {
+                flush()
+            }
+        })
+    }, interval)
+
+    // The last partial batch goes out while the socket is still open; once
+    // it closed nothing can be sent anymore.
+    window.addEventListener('pagehide', flush)
+    pc.addEventListener('connectionstatechange', () => {
+        if (pc.connectionState === 'failed' || pc.connectionState === 'closed') {
+            flush()
+        }
     })
-})
+    socket.addEventListener('close', () => {
+        clearInterval(statsTimer)
+        pending = []
+    })
+}